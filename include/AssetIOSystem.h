@@ -0,0 +1,40 @@
+#ifndef ASSET_IO_SYSTEM_H
+#define ASSET_IO_SYSTEM_H
+
+#include <assimp/IOStream.hpp>
+#include <assimp/IOSystem.hpp>
+
+#include "VirtualFileSystem.h"
+
+namespace Model
+{
+  // Read-only stream over an AssetFile; reads are memcpys out of the mapping.
+  class AssetIOStream : public Assimp::IOStream
+  {
+  public:
+    explicit AssetIOStream(AssetFile&& file);
+
+    size_t Read(void* buffer, size_t size, size_t count) override;
+    size_t Write(const void* buffer, size_t size, size_t count) override;
+    aiReturn Seek(size_t offset, aiOrigin origin) override;
+    size_t Tell() const override;
+    size_t FileSize() const override;
+    void Flush() override;
+
+  private:
+    AssetFile file;
+    size_t position;
+  };
+
+  // Routes Assimp's reads (the model and anything it references, e.g. .mtl) through the VFS.
+  class AssetIOSystem : public Assimp::IOSystem
+  {
+  public:
+    bool Exists(const char* path) const override;
+    char getOsSeparator() const override;
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override;
+    void Close(Assimp::IOStream* stream) override;
+  };
+}
+
+#endif
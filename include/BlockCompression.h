@@ -0,0 +1,36 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+enum class BlockFormat
+{
+  BC1,
+  BC3,
+  BC7
+};
+
+constexpr size_t blockBytes(BlockFormat format)
+{
+  return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedSize(unsigned int width, unsigned int height, BlockFormat format);
+
+// Every encoder and decoder works on one 4x4 block of RGBA8 texels in row-major order.
+void encodeBC1Block(const unsigned char* rgba, unsigned char* out);
+void encodeBC3Block(const unsigned char* rgba, unsigned char* out);
+void encodeBC7Block(const unsigned char* rgba, unsigned char* out);
+
+void decodeBC1Block(const unsigned char* block, unsigned char* rgba);
+void decodeBC3Block(const unsigned char* block, unsigned char* rgba);
+bool decodeBC7Block(const unsigned char* block, unsigned char* rgba);
+
+// Compresses a whole RGBA8 image. Edge blocks repeat the last row/column. Block rows are spread over the thread pool.
+std::vector<unsigned char> compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, BlockFormat format);
+
+// Software fallback for contexts that cannot sample the compressed format; returns RGBA8.
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glm/glm.hpp>
+
+// Uniform buffer binding point of the FrameConstants block in shaders/common/frame.glsl.
+constexpr unsigned int FRAME_UNIFORM_BINDING = 0;
+constexpr const char* FRAME_UNIFORM_BLOCK = "FrameConstants";
+
+// std140 mirror of the FrameConstants block: each vec3 shares its 16-byte slot with the float after it.
+struct FrameConstants
+{
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::vec3 cameraPosition;
+  float time;
+  glm::vec3 ambientColour;
+  float ambientStrength;
+};
+
+static_assert(sizeof(FrameConstants) == 3 * 64 + 2 * 16, "FrameConstants must match the std140 block layout");
+
+// Writes the constants into this frame's UploadRing region and binds them to FRAME_UNIFORM_BINDING
+// for every program. Call once per frame, after UploadRing::beginFrame and before the first draw.
+bool bindFrameConstants(const FrameConstants& constants);
+
+#endif
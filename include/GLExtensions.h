@@ -0,0 +1,82 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// The glad loader in this repo is generated for core 3.3 without extensions, so the
+// extension enums and entry points the renderer uses are declared here.
+
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_EXT_texture_sRGB
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+#ifndef GL_ARB_texture_compression_bptc
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+#ifndef GL_ARB_texture_storage
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+#endif
+
+#ifndef GL_ARB_buffer_storage
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+#endif
+
+#ifndef GL_ARB_draw_indirect
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+#ifndef GL_ARB_multi_draw_indirect
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+#endif
+
+// Record layout read by glMultiDrawElementsIndirect.
+struct DrawElementsIndirectCommand
+{
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+class GLExtensions
+{
+public:
+  bool textureCompressionS3TC;
+  bool textureCompressionBPTC;
+  bool textureStorage;
+  // ARB_buffer_storage: immutable buffers that can stay mapped while the GPU reads them.
+  bool persistentMapping;
+  // ARB_multi_draw_indirect together with ARB_base_instance, so each command can carry its draw id.
+  bool multiDrawIndirect;
+
+  PFNGLTEXSTORAGE2DPROC texStorage2D;
+  PFNGLBUFFERSTORAGEPROC bufferStorage;
+  PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect;
+
+  static const GLExtensions& get();
+
+  // Queries the current context. Call once after gladLoadGLLoader.
+  static void load();
+
+  bool supportsCompressedFormat(unsigned int internalFormat) const;
+
+private:
+  GLExtensions();
+
+  static GLExtensions& instance();
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef GEOMETRY_HEAP_H
+#define GEOMETRY_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "RangeAllocator.h"
+
+namespace Model
+{
+  enum class VertexFormat : uint32_t;
+
+  constexpr unsigned int GEOMETRY_POOL_COUNT = 2;
+  constexpr uint64_t GEOMETRY_INITIAL_VERTICES = 1 << 18;
+  constexpr uint64_t GEOMETRY_INITIAL_INDEX_BYTES = 4 << 20;
+  // Index ranges start on this boundary so 16- and 32-bit indices can share one buffer.
+  constexpr uint64_t GEOMETRY_INDEX_ALIGNMENT = 4;
+  // A free compacts a pool once this share of its free space is outside the largest free block.
+  constexpr float GEOMETRY_DEFRAGMENT_THRESHOLD = 0.5f;
+  // First of the four vec4 attribute slots holding the per-instance mat4 in instanced VAOs.
+  constexpr GLuint INSTANCE_TRANSFORM_LOCATION = 3;
+  // Per-instance uint draw id in instanced VAOs; indexes per-draw data in batched (indirect) draws.
+  constexpr GLuint DRAW_ID_LOCATION = 7;
+
+  using GeometryHandle = uint32_t;
+  constexpr GeometryHandle INVALID_GEOMETRY = ~0u;
+
+  // Where a mesh lives inside its pool: vertices are addressed through the base vertex, indices by byte offset.
+  struct GeometryRange
+  {
+    VertexFormat format;
+    uint32_t baseVertex;
+    uint32_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+  };
+
+  struct GeometryPoolStats
+  {
+    uint64_t vertexCapacity = 0;
+    uint64_t vertexUsed = 0;
+    uint64_t indexCapacity = 0;
+    uint64_t indexUsed = 0;
+    uint32_t allocations = 0;
+    uint32_t freeBlocks = 0;
+    float fragmentation = 0.0f;
+    uint32_t defragmentations = 0;
+  };
+
+  // Shared vertex and index buffers, one VAO per vertex format, sub-allocated between meshes.
+  // Ranges are resolved through handles so compaction can move them. GL thread only.
+  class GeometryHeap
+  {
+  public:
+    static GeometryHeap& shared();
+
+    GeometryHandle allocate(VertexFormat format, const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes);
+    void free(GeometryHandle handle);
+    const GeometryRange& getRange(GeometryHandle handle) const;
+
+    // Binds the format's VAO unless it is already bound. Call invalidateBinding after binding other VAOs.
+    void bind(VertexFormat format);
+    // Binds the format's instanced VAO with one column-major mat4 per instance read from `buffer` at `offset`.
+    void bindInstanced(VertexFormat format, GLuint buffer, GLintptr offset);
+    // Binds the format's draw-id VAO with one uint draw id per instance read from `buffer` at `offset`.
+    // With buffer 0 the array is disabled and every draw reads the value set by glVertexAttribI1ui.
+    void bindDrawIds(VertexFormat format, GLuint buffer, GLintptr offset);
+    void invalidateBinding();
+
+    // Moves every live range of the pool to the front of freshly allocated buffers.
+    void defragment(VertexFormat format);
+
+    GeometryPoolStats getStats(VertexFormat format) const;
+
+    // Deletes the buffers while the context is still alive; later frees only update bookkeeping.
+    void shutdown();
+
+  private:
+    struct Pool
+    {
+      GLuint vertexArray = 0;
+      // Same vertex layout plus per-instance transforms; their source is re-pointed by bindInstanced.
+      GLuint instanceArray = 0;
+      GLuint instanceBuffer = 0;
+      GLintptr instanceOffset = -1;
+      // Same vertex layout plus a per-instance draw id for the render queue; re-pointed by bindDrawIds.
+      GLuint drawIdArray = 0;
+      GLuint drawIdBuffer = 0;
+      GLintptr drawIdOffset = -1;
+      GLuint vertexBuffer = 0;
+      GLuint indexBuffer = 0;
+      size_t stride = 0;
+      RangeAllocator vertices;
+      RangeAllocator indices;
+      uint32_t allocations = 0;
+      uint32_t defragmentations = 0;
+    };
+
+    Pool pools[GEOMETRY_POOL_COUNT];
+    std::vector<GeometryRange> ranges;
+    std::vector<bool> live;
+    std::vector<GeometryHandle> freeHandles;
+    GLuint boundVertexArray;
+    bool contextAlive;
+
+    GeometryHeap();
+
+    Pool& getPool(VertexFormat format);
+    void createBuffers(Pool& pool, VertexFormat format, uint64_t vertexCapacity, uint64_t indexCapacity);
+    void setupVertexArray(Pool& pool, VertexFormat format, GLuint vertexArray);
+    void deleteVertexArrays(Pool& pool);
+    void growPool(Pool& pool, VertexFormat format, uint64_t vertexCapacity, uint64_t indexCapacity);
+  };
+
+  // Owns one heap allocation and frees it on destruction; move-only.
+  class GeometryAllocation
+  {
+  public:
+    GeometryAllocation();
+    explicit GeometryAllocation(GeometryHandle handle);
+    ~GeometryAllocation();
+
+    GeometryAllocation(GeometryAllocation&& other) noexcept;
+    GeometryAllocation& operator=(GeometryAllocation&& other) noexcept;
+    GeometryAllocation(const GeometryAllocation&) = delete;
+    GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+
+    GeometryHandle get() const;
+    bool isValid() const;
+
+  private:
+    GeometryHandle handle;
+  };
+}
+
+#endif
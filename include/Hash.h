@@ -0,0 +1,24 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// 64-bit FNV-1a over a block of bytes, chained through `hash` for multi-part keys.
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+  for (size_t i = 0; i < size; i++)
+  {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+#endif
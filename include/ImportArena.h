@@ -0,0 +1,85 @@
+#ifndef IMPORT_ARENA_H
+#define IMPORT_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+constexpr size_t IMPORT_ARENA_BLOCK_SIZE = 1024 * 1024;
+
+struct ImportArenaStats
+{
+  size_t allocations;
+  size_t bytesAllocated;
+  // Every block stays alive until the arena goes away, so this is also the arena's largest footprint.
+  size_t bytesReserved;
+  size_t blocks;
+};
+
+// Monotonic bump allocator for scratch memory that only lives for one import. Individual frees are
+// no-ops; every block is released together when the arena is destroyed. Safe to share between the
+// import's worker tasks.
+class ImportArena
+{
+public:
+  explicit ImportArena(size_t blockSize = IMPORT_ARENA_BLOCK_SIZE);
+
+  ImportArena(const ImportArena&) = delete;
+  ImportArena& operator=(const ImportArena&) = delete;
+
+  void* allocate(size_t size, size_t alignment);
+  ImportArenaStats getStats() const;
+
+private:
+  struct Block
+  {
+    std::unique_ptr<unsigned char[]> memory;
+    size_t size;
+  };
+
+  std::vector<Block> blocks;
+  unsigned char* cursor;
+  unsigned char* limit;
+  size_t blockSize;
+  ImportArenaStats stats;
+  mutable std::mutex mutex;
+};
+
+// Standard allocator adaptor so containers can draw from an ImportArena.
+template <typename T>
+class ArenaAllocator
+{
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(ImportArena& arena) noexcept: arena(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) noexcept: arena(other.arena) {}
+
+  T* allocate(size_t count)
+  {
+    return static_cast<T*>(this->arena->allocate(count * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) noexcept
+  {
+  }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const noexcept { return this->arena == other.arena; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const noexcept { return this->arena != other.arena; }
+
+private:
+  template <typename U>
+  friend class ArenaAllocator;
+
+  ImportArena* arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef INIT_GRAPH_H
+#define INIT_GRAPH_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class InitThread
+{
+  // Runs on the thread calling run(); anything touching GL or GLFW belongs here.
+  Main,
+  // Runs on the shared thread pool. Must not wait on other pool tasks, or a small pool deadlocks.
+  Worker
+};
+
+// Startup steps with explicit dependencies. Every step starts as soon as its dependencies are done,
+// so worker steps overlap with the main thread's context creation and shader compilation. Each step
+// is timed as a startup phase.
+class InitGraph
+{
+public:
+  using Task = std::function<bool()>;
+
+  unsigned int add(const std::string& name, InitThread thread, Task task, std::vector<unsigned int> dependencies = {});
+
+  // Returns false as soon as a step fails; steps already running on workers are waited for.
+  bool run();
+
+private:
+  struct Node
+  {
+    std::string name;
+    InitThread thread;
+    Task task;
+    std::vector<unsigned int> dependents;
+    unsigned int dependencyCount;
+    unsigned int remaining;
+  };
+
+  std::vector<Node> nodes;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::vector<unsigned int> mainReady;
+  unsigned int runningWorkers;
+  unsigned int completed;
+  bool failed;
+
+  bool execute(unsigned int index);
+  void finish(unsigned int index, bool success);
+  void schedule(unsigned int index);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+
+namespace Model
+{
+  struct Vertex;
+
+  constexpr unsigned int MAX_LOD_LEVELS = 8;
+  // Each generated level aims for this fraction of the previous level's triangles.
+  constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+  // Generation stops once a level keeps more than this fraction of its predecessor.
+  constexpr float LOD_MIN_REDUCTION = 0.9f;
+  // Collapses that would turn a vertex normal by more than acos of this are rejected.
+  constexpr float LOD_NORMAL_THRESHOLD = 0.5f;
+  // The coarsest level whose projected error stays under this many pixels is drawn.
+  constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+  // One level of detail: a range of the mesh's index buffer over the shared vertex buffer.
+  struct LodLevel
+  {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // Object-space geometric error relative to the full-detail mesh.
+    float error;
+  };
+
+  struct LodChain
+  {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    // Level 0 is the original mesh. Empty when no chain was generated.
+    std::vector<LodLevel> levels;
+  };
+
+  // Simplifies indices[0, size) with quadric error metrics and appends up to levelCount coarser
+  // index ranges to `indices`. Seam and border vertices are locked so UV seams stay intact.
+  LodChain generateLods(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, unsigned int levelCount);
+
+  class LodSelector
+  {
+  public:
+    // `model` maps the mesh into world space; it is assumed to scale uniformly.
+    LodSelector(const Camera& camera, float viewportHeight, const glm::mat4& model);
+
+    unsigned int select(const LodChain& chain) const;
+
+  private:
+    glm::vec3 cameraPosition;
+    // Pixels covered by one object-space unit at distance one.
+    float pixelsPerUnit;
+  };
+}
+
+#endif
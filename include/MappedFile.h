@@ -0,0 +1,32 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the object.
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  bool open(const std::string& path);
+  void close();
+
+  bool isOpen() const;
+  const unsigned char* data() const;
+  size_t size() const;
+
+private:
+  void* mapping;
+  size_t length;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -15,7 +17,11 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "GeometryHeap.h"
+#include "Lod.h"
+#include "Meshlet.h"
 #include "Shader.h"
+#include "TextureRegistry.h"
 
 namespace Model
 {
@@ -26,28 +32,190 @@ namespace Model
     glm::vec2 texCoords;
   };
 
+  enum class VertexFormat : uint32_t
+  {
+    // Vertex as-is: 32 bytes.
+    Float = 0,
+    // PackedVertex: 16 bytes, dequantized by the vertex attribute setup and the positionOffset/positionScale uniforms.
+    Packed = 1
+  };
+
+  struct PackedVertex
+  {
+    // unorm16 relative to the mesh bounds; the fourth component keeps the normal 4-byte aligned.
+    uint16_t position[4];
+    // snorm 10_10_10_2, matching GL_INT_2_10_10_10_REV.
+    uint32_t normal;
+    // IEEE half floats so tiled UVs outside [0, 1] survive.
+    uint16_t texCoords[2];
+  };
+
+  // Packed positions decode as offset + scale * unorm.
+  struct VertexQuantization
+  {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+  };
+
+  // Meshes with at most this many vertices store and draw 16-bit indices.
+  constexpr size_t SHORT_INDEX_VERTEX_LIMIT = 65536;
+
+  size_t indexSize(GLenum indexType);
+
+  // What a mesh keeps in RAM once its geometry is in the GPU heap.
+  enum class GeometryResidency
+  {
+    // Full vertex and index arrays (needed to write a mesh cache or re-process the mesh). Meshes loaded
+    // from a mesh cache keep them as views into the mapped file instead; see Mesh::loadCpuGeometry().
+    Keep,
+    // Nothing; the GPU copy is the only one.
+    Discard,
+    // Decoded positions and the full-detail indices only, for picking and collision.
+    Positions
+  };
+
+  struct GeometryMemory
+  {
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+  };
+
   struct Texture
   {
     unsigned int id;
     std::string type;
     aiString path;
+    TextureHandle handle;
+  };
+
+  // Numbers recorded by the optional processing passes on the worker, reported once the model has loaded.
+  struct MeshProcessingStats
+  {
+    bool welded = false;
+    unsigned int verticesBefore = 0;
+    unsigned int verticesAfter = 0;
+
+    bool optimized = false;
+    float acmrBefore = 0.0f;
+    float atvrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    float atvrAfter = 0.0f;
+
+    bool quantized = false;
+    size_t vertexBytesBefore = 0;
+    size_t vertexBytesAfter = 0;
+
+    size_t meshletCount = 0;
+
+    std::vector<unsigned int> lodTriangles;
+  };
+
+  // CPU-side result of importing one mesh, produced off the GL thread and uploaded later.
+  struct MeshData
+  {
+    VertexFormat vertexFormat = VertexFormat::Float;
+    std::vector<Vertex> vertices;
+    std::vector<PackedVertex> packedVertices;
+    VertexQuantization quantization;
+    std::vector<unsigned int> indices;
+    std::vector<Meshlet> meshlets;
+    LodChain lods;
+    std::vector<Texture> textures;
+    // Files behind `textures`, read and hashed on the worker so the GL thread only does registry lookups.
+    std::vector<TextureSource> textureSources;
+    MeshProcessingStats stats;
   };
 
   class Mesh
   {
   public:
     std::vector<Vertex> vertices;
+    std::vector<PackedVertex> packedVertices;
+    // Only one index array is filled, chosen by getIndexType() when the mesh is created.
     std::vector<unsigned int> indices;
+    std::vector<uint16_t> shortIndices;
+    // Filled by applyResidency(GeometryResidency::Positions) in place of the vertex arrays.
+    std::vector<glm::vec3> positions;
     std::vector<Texture> textures;
 
     Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    Mesh(std::vector<PackedVertex> vertices, const VertexQuantization& quantization, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // `indices` holds numIndices elements of indexType (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+    Mesh(const Vertex* vertices, size_t numVertices, const void* indices, GLenum indexType, size_t numIndices, std::vector<Texture> textures);
+    Mesh(const PackedVertex* vertices, size_t numVertices, const VertexQuantization& quantization, const void* indices, GLenum indexType, size_t numIndices, std::vector<Texture> textures);
 
-    void draw(Shader& shader);
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(Mesh&&) = default;
+
+    // Draws `instanceCount` copies, each transformed by one mat4 read from `instanceBuffer` at `instanceOffset`.
+    void drawInstanced(Shader& shader, GLuint instanceBuffer, GLintptr instanceOffset, GLsizei instanceCount);
+
+    // Appends the index ranges a draw would submit (byte offsets into the heap's index buffer) and
+    // returns how many were added. With `cull`, level 0 is cut down to the visible meshlets.
+    unsigned int appendDrawRanges(unsigned int level, const MeshletCullContext* cull, MeshletCullStats* stats, std::vector<GLsizei>& counts, std::vector<const void*>& offsets) const;
+    // Binds the textures and sets the dequantization uniforms the shader expects.
+    void bindTextures(Shader& shader) const;
+    void bindQuantization(Shader& shader) const;
+    GeometryHandle getGeometry() const;
+    // Object-space point used for depth sorting: the LOD bounds centre, else the meshlet centroid.
+    const glm::vec3& getCenter() const;
+
+    void setMeshlets(std::vector<Meshlet> meshlets);
+    const std::vector<Meshlet>& getMeshlets() const;
+    void setLods(LodChain lods);
+    const LodChain& getLods() const;
+
+    VertexFormat getVertexFormat() const;
+    const VertexQuantization& getQuantization() const;
+    GLenum getIndexType() const;
+    const void* getIndexData() const;
+    size_t getIndexCount() const;
+
+    // Releases or compacts the CPU arrays; the GPU copy is untouched.
+    void applyResidency(GeometryResidency residency);
+    GeometryMemory getMemory() const;
+
+    // Meshes loaded from a mesh cache keep their CPU geometry as views into the mapped file, which
+    // `mapping` keeps alive. getIndexData() reads through the view; the public arrays stay empty until
+    // a caller asks for owned copies with loadCpuGeometry().
+    void setMappedGeometry(std::shared_ptr<const void> mapping, const void* vertices, size_t numVertices, const void* indices, size_t numIndices);
+    bool hasMappedGeometry() const;
+    void loadCpuGeometry();
 
   private:
-    unsigned int VAO, VBO, EBO;
+    // Vertex and index ranges inside the shared GeometryHeap; freeing them makes Mesh move-only.
+    GeometryAllocation geometry;
+    unsigned int indexCount;
+    GLenum indexType;
+    VertexFormat vertexFormat;
+    VertexQuantization quantization;
+    std::vector<Meshlet> meshlets;
+    LodChain lods;
+    glm::vec3 center = glm::vec3(0.0f);
+
+    std::shared_ptr<const void> mapping;
+    const void* mappedVertices = nullptr;
+    size_t mappedVertexCount = 0;
+    const void* mappedIndices = nullptr;
+    size_t mappedIndexCount = 0;
+
+    // Sampler and dequantization uniforms of the program the mesh was last bound with.
+    struct MaterialUniforms
+    {
+      unsigned int program = 0;
+      std::vector<UniformHandle> samplers;
+      UniformHandle positionOffset;
+      UniformHandle positionScale;
+    };
+
+    mutable MaterialUniforms materialUniforms;
 
-    void setupMesh();
+    // Index range of one level; level 0, or any level past the chain, is the full-detail mesh.
+    void getLevelRange(unsigned int level, unsigned int& firstIndex, unsigned int& count) const;
+    const MaterialUniforms& resolveUniforms(const Shader& shader) const;
+    void bindMaterial(Shader& shader) const;
+    void storeIndices(std::vector<unsigned int> indices, size_t numVertices);
+    void setupMesh(const void* vertices, size_t numVertices, const void* indices, size_t numIndices);
   };
 }
 
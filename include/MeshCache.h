@@ -0,0 +1,97 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "VirtualFileSystem.h"
+
+namespace Model
+{
+  // Bump whenever the on-disk layout or the meaning of the stored buffers changes.
+  constexpr uint32_t MESH_CACHE_VERSION = 6;
+  constexpr char MESH_CACHE_MAGIC[8] = { 'M', '3', '9', '2', 'M', 'S', 'H', 'C' };
+  constexpr const char* MESH_CACHE_EXTENSION = ".meshcache";
+
+  struct SourceFingerprint
+  {
+    uint64_t size;
+    uint64_t hash;
+    // Hash of the import options that shaped the stored meshes; a cache built with other options is stale.
+    uint64_t processing;
+  };
+
+  struct MeshCacheHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t meshCount;
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t processingHash;
+  };
+
+  struct MeshCacheEntry
+  {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t textureOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t vertexFormat;
+    float positionOffset[3];
+    float positionScale[3];
+    uint32_t indexType;
+    uint32_t meshletCount;
+    uint64_t meshletOffset;
+    float lodCenter[3];
+    float lodRadius;
+    uint64_t lodOffset;
+    uint32_t lodCount;
+    uint32_t reserved;
+  };
+
+  struct CachedTexture
+  {
+    std::string type;
+    std::string path;
+  };
+
+  // View of one mesh inside a mapped cache file. The pointers stay valid while the MeshCache is open.
+  struct CachedMesh
+  {
+    VertexFormat vertexFormat;
+    // Exactly one of these is set, depending on vertexFormat.
+    const Vertex* vertices;
+    const PackedVertex* packedVertices;
+    VertexQuantization quantization;
+    uint32_t vertexCount;
+    const void* indices;
+    GLenum indexType;
+    uint32_t indexCount;
+    const Meshlet* meshlets;
+    uint32_t meshletCount;
+    LodChain lods;
+    std::vector<CachedTexture> textures;
+  };
+
+  class MeshCache
+  {
+  public:
+    static std::string cachePath(const std::string& sourcePath);
+    static bool fingerprint(const std::string& sourcePath, SourceFingerprint& fingerprint);
+    static bool write(const std::string& sourcePath, const SourceFingerprint& fingerprint, const std::vector<Mesh>& meshes);
+
+    bool open(const std::string& sourcePath, const SourceFingerprint& fingerprint);
+    const std::vector<CachedMesh>& getMeshes() const;
+
+  private:
+    AssetFile file;
+    std::vector<CachedMesh> meshes;
+  };
+}
+
+#endif
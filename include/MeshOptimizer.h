@@ -0,0 +1,39 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+
+#include "Mesh.h"
+
+namespace Model
+{
+  // FIFO size assumed when ordering triangles and when measuring cache efficiency.
+  constexpr unsigned int VERTEX_CACHE_SIZE = 16;
+  // A cluster is split wherever its running ACMR drops within this factor of the whole mesh's ACMR.
+  constexpr float OVERDRAW_CLUSTER_THRESHOLD = 1.05f;
+
+  struct VertexCacheStats
+  {
+    // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for regular grids, 3 is worst).
+    float acmr;
+    // Average transform to vertex ratio: transformed vertices per referenced vertex (1 is ideal).
+    float atvr;
+  };
+
+  VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+  // Tipsify (Sander et al. 2007). Reorders triangles for post-transform cache locality and
+  // returns the first triangle of every cluster that started at a dead end.
+  std::vector<unsigned int> optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+  // Splits the Tipsify clusters further and sorts them so outward-facing clusters draw first.
+  void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusters, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+  // Renumbers vertices in first-use order and drops ones no triangle references.
+  void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+  // Runs all three passes and records before/after cache statistics in data.stats.
+  void optimizeMesh(MeshData& data);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace Model
+{
+  struct Vertex;
+
+  constexpr unsigned int MESHLET_MAX_VERTICES = 64;
+  constexpr unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+  // A contiguous range of a mesh's index buffer plus the bounds used to cull it.
+  struct Meshlet
+  {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneAxis;
+    // Back-facing test threshold; 1 disables cone culling for meshlets whose normals spread too far.
+    float coneCutoff;
+  };
+
+  // Frustum and eye in the mesh's object space, so meshlet bounds are tested without transforming them.
+  // Cone culling assumes the model matrix has no non-uniform scale, and only matches the unculled
+  // result when GL_CULL_FACE is on, so it is skipped unless `backfaceCulling` says so.
+  struct MeshletCullContext
+  {
+    glm::vec4 planes[6];
+    glm::vec3 cameraPosition;
+    bool backfaceCulling;
+
+    MeshletCullContext(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model, bool backfaceCulling = false);
+  };
+
+  struct MeshletCullStats
+  {
+    unsigned int visible = 0;
+    unsigned int total = 0;
+    unsigned int drawRanges = 0;
+  };
+
+  // Partitions the triangles, in their current order, into meshlets. The index order is kept, so
+  // running it after optimizeVertexCache keeps each meshlet's vertices close together.
+  std::vector<Meshlet> buildMeshlets(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+  bool isMeshletVisible(const Meshlet& meshlet, const MeshletCullContext& context);
+}
+
+#endif
@@ -6,6 +6,8 @@
 #include <sstream>
 #include <map>
 #include <vector>
+#include <future>
+#include <memory>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -18,28 +20,107 @@
 #include <assimp/postprocess.h>
 
 #include "Shader.h"
+#include "ImportArena.h"
 #include "Mesh.h"
-
-unsigned int TextureFromFile(std::string path, const std::string& directory);
+#include "MeshCache.h"
+#include "RenderQueue.h"
+#include "VertexQuantizer.h"
+#include "VertexWelder.h"
 
 namespace Model
 {
+  // How many finished meshes uploadPending pushes to the GPU per call by default.
+  constexpr unsigned int MESH_UPLOADS_PER_FRAME = 8;
+
+  struct LodStats
+  {
+    unsigned int trianglesDrawn = 0;
+    unsigned int fullDetailTriangles = 0;
+  };
+
+  enum class ModelImporter
+  {
+    Assimp,
+    // Streaming OBJ parser in ObjLoader; other extensions still go through Assimp.
+    NativeObj
+  };
+
+  struct ModelOptions
+  {
+    ModelImporter importer = ModelImporter::Assimp;
+    // Merge duplicate vertices (VertexWelder) before any other processing.
+    bool weldVertices = false;
+    WeldTolerance weldTolerance;
+    // Reorder triangles and vertices for the post-transform cache, overdraw and fetch (MeshOptimizer).
+    bool optimizeMeshes = false;
+    // Split meshes into meshlets with culling bounds, used by draw(shader, cull).
+    bool buildMeshlets = false;
+    // Number of coarser levels generated with quadric simplification, selected per draw by LodSelector.
+    unsigned int lodLevels = 0;
+    // Packed halves vertex memory; shaders drawing the model must apply positionOffset/positionScale.
+    VertexFormat vertexFormat = VertexFormat::Float;
+    // CPU copy kept after upload. Not part of hash(): the cache stores the same geometry either way.
+    GeometryResidency residency = GeometryResidency::Keep;
+
+    uint64_t hash() const;
+  };
+
   class Model
   {
   public:
-    Model(std::string path);
-    void draw(Shader& shader);
+    Model(std::string path, ModelOptions options = ModelOptions());
+    ~Model();
+
+    // One instanced draw per mesh for all of `transforms`, streamed through the UploadRing. The shader
+    // takes the transform from the mat4 attribute at INSTANCE_TRANSFORM_LOCATION instead of "model".
+    void drawInstanced(Shader& shader, const glm::mat4* transforms, size_t count);
+    void drawInstanced(Shader& shader, const std::vector<glm::mat4>& transforms);
+    // Picks a level of detail per mesh from its projected error and culls the meshlets of full-detail
+    // meshes, then pushes them into `queue` to be sorted against everything else drawn this frame.
+    // `transform` comes from queue.addTransform; the shader reads it through drawTransforms/drawBase.
+    void enqueue(RenderQueue& queue, Shader& shader, uint32_t transform, const MeshletCullContext& cull, const LodSelector& lod, RenderPass pass = RenderPass::Opaque);
+    const MeshletCullStats& getCullStats() const;
+    const LodStats& getLodStats() const;
+    // Live CPU and GPU bytes held by the model's meshes.
+    GeometryMemory getMemory() const;
+
+    // Uploads up to maxMeshes meshes whose CPU processing has finished. Must run on the GL thread.
+    void uploadPending(unsigned int maxMeshes = MESH_UPLOADS_PER_FRAME);
+    void finishLoading();
+    bool isLoaded() const;
 
   private:
-    std::vector<Texture> texturesLoaded;
     std::vector<Mesh> meshes;
     std::string directory;
+    std::string path;
+
+    ModelOptions options;
+    SourceFingerprint fingerprint;
+    bool hasFingerprint;
+    bool loading;
+
+    std::unique_ptr<Assimp::Importer> importer;
+    // Worker scratch of an Assimp import (vertex welding), released in one go once every mesh is uploaded.
+    std::unique_ptr<ImportArena> importArena;
+    std::vector<std::future<MeshData>> pendingMeshes;
+    size_t nextPendingMesh;
+    std::vector<MeshProcessingStats> processingStats;
+    MeshletCullStats cullStats;
+    LodStats lodStats;
 
     void loadModel(std::string path);
+    bool loadCache(const std::string& path, const SourceFingerprint& fingerprint);
+    bool loadNativeObj(const std::string& path);
     void processNode(aiNode* node, const aiScene* scene);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    void uploadMesh(MeshData data);
+    void reportProcessing() const;
+    void reportMemory() const;
+    static void reportImport(const std::string& path, const ImportArenaStats& scratch, size_t outputBytes);
+    static MeshData processMesh(const aiMesh* mesh, const aiScene* scene);
+    static MeshData postProcessMesh(MeshData data, const ModelOptions& options, const std::string& directory, ImportArena* arena);
+    static void collectMaterialTextures(const aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures);
+    Texture loadTexture(const TextureSource& source, const aiString& path, const std::string& typeName);
   };
 }
 
-#endif
\ No newline at end of file
+#endif
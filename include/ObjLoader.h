@@ -0,0 +1,27 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <string>
+#include <vector>
+
+#include "ImportArena.h"
+#include "Mesh.h"
+
+namespace Model
+{
+  // Native Wavefront OBJ/MTL reader. The file is mapped, split into line-aligned chunks that are
+  // parsed in parallel, then merged into one MeshData per material with (v, vt, vn) triplets
+  // deduplicated into Vertex entries. UVs are flipped to match aiProcess_FlipUVs. All scratch
+  // memory comes from `arena`; only the returned MeshData uses the regular heap.
+  bool loadObj(const std::string& path, std::vector<MeshData>& meshes, ImportArena& arena);
+
+  // Material libraries (mtllib) referenced by the OBJ text in data, resolved against the directory of
+  // `path` the same way loadObj opens them.
+  std::vector<std::string> findMaterialLibraries(const std::string& path, const unsigned char* data, size_t size);
+
+  // Parses a decimal floating point number and advances `p` past it. Eight digits at a time are
+  // converted with SWAR arithmetic when at least eight bytes remain before `end`.
+  float parseFloat(const char*& p, const char* end);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PACK_FILE_H
+#define PACK_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+constexpr uint32_t PACK_FILE_VERSION = 1;
+constexpr char PACK_FILE_MAGIC[8] = { 'M', '3', '9', '2', 'P', 'A', 'C', 'K' };
+constexpr const char* PACK_FILE_EXTENSION = ".pack";
+
+struct PackHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t entryCount;
+  uint64_t indexOffset;
+  uint64_t stringOffset;
+};
+
+// Index entries are sorted by pathHash; the stored path settles hash collisions.
+struct PackEntry
+{
+  uint64_t pathHash;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t pathOffset;
+  uint32_t pathLength;
+};
+
+// Read-only archive mapped once; lookups return views straight into the mapping.
+class PackFile
+{
+public:
+  // Packs `paths` (relative to root, '/'-separated) into one archive.
+  static bool write(const std::string& outputPath, const std::string& root, const std::vector<std::string>& paths);
+  static uint64_t hashPath(const std::string& path);
+
+  bool open(const std::string& path);
+  bool find(const std::string& path, const unsigned char*& data, size_t& size) const;
+  uint32_t getEntryCount() const;
+
+private:
+  MappedFile file;
+  const PackEntry* entries = nullptr;
+  const char* strings = nullptr;
+  uint32_t entryCount = 0;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+// Best-fit sub-allocator for offsets inside one large buffer. Free blocks are indexed by (size, offset)
+// for O(log n) allocation and removal, and by offset so neighbours coalesce on free.
+class RangeAllocator
+{
+public:
+  explicit RangeAllocator(uint64_t capacity = 0);
+
+  bool allocate(uint64_t size, uint64_t& offset);
+  void free(uint64_t offset, uint64_t size);
+
+  // Extends the range; the new space joins any free block at the old end.
+  void grow(uint64_t capacity);
+  // Marks [0, used) allocated and the rest free, as after compacting every allocation to the front.
+  void reset(uint64_t capacity, uint64_t used);
+
+  uint64_t getCapacity() const;
+  uint64_t getUsed() const;
+  uint64_t getLargestFreeBlock() const;
+  uint32_t getFreeBlockCount() const;
+  // 0 when all free space is one block, approaching 1 as it splinters.
+  float getFragmentation() const;
+
+private:
+  uint64_t capacity;
+  uint64_t used;
+  std::map<uint64_t, uint64_t> freeByOffset;
+  std::set<std::pair<uint64_t, uint64_t>> freeBySize;
+
+  void insertFree(uint64_t offset, uint64_t size);
+  void eraseFree(std::map<uint64_t, uint64_t>::iterator block);
+};
+
+#endif
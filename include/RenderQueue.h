@@ -0,0 +1,125 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "GLExtensions.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+// Texture unit of the samplerBuffer that batched programs read their per-draw transforms from.
+constexpr unsigned int DRAW_TRANSFORM_TEXTURE_UNIT = 15;
+
+// Passes run in this order; the value is the top two bits of every sort key.
+enum class RenderPass : uint8_t
+{
+  Opaque = 0,
+  Transparent = 1
+};
+
+struct RenderQueueStats
+{
+  unsigned int items = 0;
+  unsigned int drawCalls = 0;
+  unsigned int programChanges = 0;
+  unsigned int materialChanges = 0;
+  unsigned int vertexArrayChanges = 0;
+  // Byte-wide radix passes actually run; digits shared by every key are skipped.
+  unsigned int sortPasses = 0;
+  // Runs of items submitted together by programs that read per-draw data, and the ranges they covered.
+  unsigned int batches = 0;
+  unsigned int batchedDraws = 0;
+  // Draws of runs that found the UploadRing full and went out one call each instead.
+  unsigned int overflowDraws = 0;
+};
+
+// Collects the frame's draws with a 64-bit key, radix-sorts them and submits them with redundant state
+// changes removed. Opaque keys are [pass 2][program 10][material 16][vertex format 4][depth 32] so state
+// groups come first and ties run front-to-back; transparent keys put the inverted depth straight after
+// the pass so they run back-to-front. Index ranges are resolved when an item is pushed, so push and
+// submit must happen in the same frame with no geometry uploads in between.
+//
+// Programs that declare `samplerBuffer drawTransforms` are batched: each run of sorted items sharing the
+// program, material, vertex format and index type becomes one glMultiDrawElementsIndirect. The run's
+// transforms (with the mesh dequantization folded in) and commands are streamed through the UploadRing,
+// and the shader finds its transform with texelFetch at (drawBase + drawId) * 4. Without
+// ARB_multi_draw_indirect the same commands are issued one by one, which is also how a run is drawn when
+// the ring has no room left this frame (its transforms then go through a buffer of the queue's own).
+// GL thread only.
+class RenderQueue
+{
+public:
+  RenderQueue();
+
+  // Clears last frame's items. `view` is used for the depth part of the keys.
+  void begin(const glm::mat4& view);
+  // Returns the index items pass to push(); submit() sets it as the "model" uniform.
+  uint32_t addTransform(const glm::mat4& transform);
+  // Queues one level of a mesh. With `cull`, level 0 is reduced to its visible meshlets; nothing is
+  // queued when none survive.
+  void push(RenderPass pass, Shader& shader, const Model::Mesh& mesh, uint32_t transform, unsigned int level = 0, const Model::MeshletCullContext* cull = nullptr, Model::MeshletCullStats* cullStats = nullptr);
+  void submit();
+
+  const RenderQueueStats& getStats() const;
+
+  // Deletes the per-draw transform texture and overflow buffer while the context is still alive.
+  void shutdown();
+
+private:
+  struct Item
+  {
+    Shader* shader;
+    const Model::Mesh* mesh;
+    uint32_t transform;
+    uint16_t material;
+    uint32_t firstRange;
+    uint32_t rangeCount;
+  };
+
+  // Handles of the program currently in use; drawTransforms is only valid for batched programs.
+  struct ProgramUniforms
+  {
+    UniformHandle model;
+    UniformHandle drawTransforms;
+    UniformHandle drawBase;
+  };
+
+  struct SortEntry
+  {
+    uint64_t key;
+    uint32_t item;
+  };
+
+  glm::mat4 view;
+  std::vector<glm::mat4> transforms;
+  std::vector<Item> items;
+  std::vector<GLsizei> counts;
+  std::vector<const void*> offsets;
+  std::vector<GLint> baseVertices;
+  std::vector<SortEntry> entries;
+  std::vector<SortEntry> scratch;
+  // Dense ids so programs and texture sets fit their key fields; kept across frames so keys stay stable.
+  std::unordered_map<unsigned int, uint16_t> programIds;
+  std::unordered_map<uint64_t, uint16_t> materialIds;
+  RenderQueueStats stats;
+  ProgramUniforms programUniforms;
+  std::vector<glm::mat4> batchTransforms;
+  std::vector<GLuint> batchDrawIds;
+  std::vector<DrawElementsIndirectCommand> batchCommands;
+  GLuint transformTexture;
+  GLuint transformTextureBuffer;
+  GLuint overflowBuffer;
+
+  uint16_t getProgramId(const Shader& shader);
+  uint16_t getMaterialId(const Model::Mesh& mesh);
+  void sort();
+  // Submits the run of entries that can share a draw with entries[first]; returns the index after it.
+  size_t submitBatch(size_t first, Shader& program);
+};
+
+#endif
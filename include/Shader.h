@@ -2,8 +2,20 @@
 #define SHADER_H
 
 #include <string>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
+// How deep `#include "file"` directives in shader sources may nest.
+constexpr unsigned int SHADER_INCLUDE_DEPTH = 8;
+
+// A uniform location resolved once after link. Setting an invalid handle does nothing, like location -1 in GL.
+struct UniformHandle
+{
+  int location = -1;
+
+  bool isValid() const { return this->location >= 0; }
+};
+
 class Shader
 {
 public:
@@ -12,6 +24,25 @@ public:
   Shader(std::string vertexShaderPath, std::string fragmentShaderPath);
 
   void use();
+
+  // Looks the name up in the table reflected at link time; arrays answer to "name", "name[0]", "name[1]"...
+  UniformHandle getUniform(const std::string& name) const;
+  unsigned int getUniformCount() const;
+
+  // Hot paths should resolve a handle once and use these; they are a single glUniform* call.
+  void setBool(UniformHandle uniform, bool value) const;
+  void setInt(UniformHandle uniform, int value) const;
+  void setFloat(UniformHandle uniform, float value) const;
+
+  void setVec2(UniformHandle uniform, const glm::vec2& value) const;
+  void setVec3(UniformHandle uniform, const glm::vec3& value) const;
+  void setVec4(UniformHandle uniform, const glm::vec4& value) const;
+
+  void setMat2(UniformHandle uniform, const glm::mat2& mat) const;
+  void setMat3(UniformHandle uniform, const glm::mat3& mat) const;
+  void setMat4(UniformHandle uniform, const glm::mat4& mat) const;
+
+  // By name: a hash lookup in the reflected table, never a driver query.
   void setBool(const std::string& name, bool value) const;
   void setInt(const std::string& name, int value) const;
   void setFloat(const std::string& name, float value) const;
@@ -25,7 +56,11 @@ public:
   void setMat4(const std::string& name, const glm::mat4& mat) const;
 
 private:
+  std::unordered_map<std::string, int> uniforms;
+
+  static bool readSource(const std::string& path, std::string& source, unsigned int depth);
   void checkCompileErrors(unsigned int shader, std::string type);
+  void reflectUniforms();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr const char* STARTUP_TRACE_PATH = "startup_trace.json";
+
+struct StartupEvent
+{
+  std::string name;
+  unsigned int thread;
+  // Milliseconds since process start; instant marks have end == start.
+  double start;
+  double end;
+};
+
+// Times startup phases from any thread. Once the first frame is presented the report is printed
+// and exported in the Chrome trace event format (load it in chrome://tracing or Perfetto).
+class StartupProfiler
+{
+public:
+  static StartupProfiler& shared();
+
+  double now() const;
+  void record(const std::string& name, double start, double end);
+  void mark(const std::string& name);
+
+  void markFirstFrame();
+  double getTimeToFirstFrame() const;
+
+  void printReport() const;
+  bool exportTrace(const std::string& path) const;
+
+private:
+  mutable std::mutex mutex;
+  std::vector<StartupEvent> events;
+  std::vector<std::thread::id> threads;
+  double firstFrame;
+
+  StartupProfiler();
+
+  unsigned int threadIndex(std::thread::id id);
+};
+
+// Records the enclosing scope as one startup phase.
+class StartupPhase
+{
+public:
+  explicit StartupPhase(std::string name);
+  ~StartupPhase();
+
+  StartupPhase(const StartupPhase&) = delete;
+  StartupPhase& operator=(const StartupPhase&) = delete;
+
+private:
+  std::string name;
+  double start;
+};
+
+#endif
@@ -9,6 +9,7 @@ class Texture
 public:
   unsigned int id;
 
+  // 0x0 while an image loaded from a path is still being decoded; isLoaded() fills in the real values.
   unsigned int width, height;
   unsigned int internalFormat, imageFormat;
 
@@ -21,6 +22,11 @@ public:
   void generate(unsigned int width, unsigned int height, unsigned char* data);
 
   void bind() const;
+  // Picks up the size and format of a texture the loader finished uploading. GL thread only.
+  bool isLoaded();
+
+private:
+  bool pending;
 };
 
 #endif
\ No newline at end of file
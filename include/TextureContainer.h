@@ -0,0 +1,85 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "VirtualFileSystem.h"
+
+// Bump whenever the on-disk layout or the meaning of the stored levels changes.
+constexpr uint32_t TEXTURE_CONTAINER_VERSION = 3;
+constexpr char TEXTURE_CONTAINER_MAGIC[8] = { 'M', '3', '9', '2', 'T', 'E', 'X', 'C' };
+constexpr const char* TEXTURE_CONTAINER_EXTENSION = ".ctex";
+constexpr unsigned int CUBEMAP_FACE_COUNT = 6;
+
+// Bytes a texture occupies on the GPU, next to what the same levels would take as plain RGBA8.
+struct TextureMemory
+{
+  size_t residentBytes;
+  size_t uncompressedBytes;
+};
+
+// Compressed levels store format = type = 0 and their block-compressed GL internal format.
+// Cube maps have six faces; the level table is level-major (all faces of level 0 first).
+struct TextureContainerHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levelCount;
+  uint32_t faceCount;
+  uint32_t internalFormat;
+  uint32_t format;
+  uint32_t type;
+  uint64_t sourceSize;
+  uint64_t sourceHash;
+};
+
+struct TextureContainerLevel
+{
+  uint64_t offset;
+  uint64_t size;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Pixel data for one cooked mip level, used when writing a container.
+struct TextureLevelData
+{
+  uint32_t width;
+  uint32_t height;
+  std::vector<unsigned char> pixels;
+};
+
+// Cooked texture: every mip level already filtered and stored in its final GL format, so
+// loading is a mapping plus one glTexImage2D per level.
+class TextureContainer
+{
+public:
+  static std::string cookedPath(const std::string& sourcePath);
+  static bool write(const std::string& path, TextureContainerHeader header, const std::vector<TextureLevelData>& levels);
+  static bool isCompressedFormat(unsigned int internalFormat, BlockFormat& format, bool& srgb);
+  // The sourceSize/sourceHash cookCubemap stores for these faces, so a stale cube map can be detected.
+  static bool fingerprintCubemap(const std::vector<std::string>& facePaths, uint64_t& sourceSize, uint64_t& sourceHash);
+
+  bool open(const std::string& path, AssetLookup lookup = AssetLookup::PackFirst);
+  bool matchesSource(uint64_t sourceSize, uint64_t sourceHash) const;
+
+  const TextureContainerHeader& getHeader() const;
+  size_t getDataSize() const;
+
+  const TextureContainerLevel& getLevel(unsigned int level, unsigned int face = 0) const;
+  const unsigned char* getLevelData(unsigned int level, unsigned int face = 0) const;
+
+private:
+  AssetFile file;
+  TextureContainerHeader header;
+  const TextureContainerLevel* levels;
+};
+
+#endif
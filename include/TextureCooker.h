@@ -0,0 +1,32 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include <string>
+#include <vector>
+
+#include "TextureContainer.h"
+
+struct TextureCookOptions
+{
+  // Store as GL_SRGB8(_ALPHA8) so sampling linearizes; otherwise keep the plain RGB(A)8 the runtime used.
+  bool srgb;
+  bool generateMipmaps;
+
+  // Block-compress every level (BC1 for opaque colour, BC3/BC7 with alpha) instead of storing RGB(A)8.
+  bool compress;
+  BlockFormat blockFormat;
+};
+
+// Builds the full mip chain by averaging 2x2 blocks in linear space, so lower levels keep the
+// same perceived brightness as the base image.
+std::vector<TextureLevelData> buildMipChain(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, bool generateMipmaps);
+
+bool cookTexture(const std::string& sourcePath, const std::string& outputPath, const TextureCookOptions& options);
+
+// Options that cook the same kind of container again, for rebuilding one whose sources changed.
+TextureCookOptions cookOptionsFor(const TextureContainerHeader& header);
+
+// Packs six faces in +X, -X, +Y, -Y, +Z, -Z order into one cube map container.
+bool cookCubemap(const std::vector<std::string>& facePaths, const std::string& outputPath, const TextureCookOptions& options);
+
+#endif
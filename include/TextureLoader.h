@@ -0,0 +1,120 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureContainer.h"
+
+constexpr unsigned int PIXEL_BUFFER_RING_SIZE = 4;
+constexpr size_t TEXTURE_UPLOAD_BUDGET = 16 * 1024 * 1024;
+
+// Size and format of a texture whose decoded image has reached the GPU.
+struct TextureImageInfo
+{
+  unsigned int width, height;
+  unsigned int internalFormat, format;
+};
+
+// Cube map faces decoding on the thread pool. Needs no GL context, so the decode can start before
+// the window exists and be uploaded once it does.
+struct PendingCubemap
+{
+  struct Face
+  {
+    int width, height, channels;
+    unsigned char* pixels;
+  };
+
+  std::vector<std::string> faces;
+  std::vector<std::future<Face>> decodes;
+};
+
+// Decodes images on the shared thread pool and streams them to the GPU through a ring of
+// pixel buffer objects. Texture ids are handed out immediately with a 1x1 placeholder and the
+// real image replaces the placeholder's storage once it has been uploaded.
+class TextureLoader
+{
+public:
+  static TextureLoader& shared();
+
+  ~TextureLoader();
+
+  unsigned int load(const std::string& path, bool generateMipmaps = true);
+  void loadInto(unsigned int textureId, const std::string& path, bool generateMipmaps);
+
+  // Cooked textures need no decode, so they are uploaded straight from the mapping.
+  unsigned int loadCooked(const TextureContainer& container);
+  void uploadCooked(unsigned int textureId, const TextureContainer& container);
+
+  // Cube maps in +X, -X, +Y, -Y, +Z, -Z order. The faces are decoded in parallel and uploaded into
+  // storage that is allocated once. A packed cube map container skips decoding entirely; it
+  // returns 0 when the file is missing, not a cube map, or cooked from other faces than the
+  // fingerprint (TextureContainer::fingerprintCubemap) describes.
+  unsigned int loadCubemap(const std::vector<std::string>& faces);
+  static PendingCubemap decodeCubemap(const std::vector<std::string>& faces);
+  unsigned int uploadCubemap(PendingCubemap& pending);
+  unsigned int loadCookedCubemap(const std::string& path, uint64_t sourceSize, uint64_t sourceHash);
+
+  // GPU memory accounting for every texture uploaded through the loader. Call forget() before deleting
+  // a texture: it also abandons a decode still in flight, which would otherwise land in a reused id.
+  void forget(unsigned int textureId);
+  TextureMemory getMemory() const;
+
+  // False until update() has uploaded the image loadInto() started for textureId.
+  bool getImageInfo(unsigned int textureId, TextureImageInfo& info) const;
+
+  // Uploads decoded images until byteBudget is spent. Must run on the GL thread, once per frame.
+  void update(size_t byteBudget = TEXTURE_UPLOAD_BUDGET);
+  void finish();
+  bool isIdle();
+
+private:
+  struct DecodedImage
+  {
+    unsigned int textureId;
+    uint64_t job;
+    std::string path;
+    int width, height, channels;
+    unsigned char* pixels;
+    bool generateMipmaps;
+  };
+
+  struct PixelBuffer
+  {
+    unsigned int id;
+    size_t capacity;
+    GLsync fence;
+  };
+
+  std::vector<PixelBuffer> ring;
+  unsigned int nextBuffer;
+
+  std::unordered_map<unsigned int, TextureMemory> textureMemory;
+  TextureMemory totalMemory;
+  std::unordered_map<unsigned int, TextureImageInfo> imageInfo;
+
+  std::mutex mutex;
+  std::condition_variable decodeFinished;
+  std::deque<DecodedImage> decoded;
+  unsigned int decoding;
+  // Latest loadInto() per texture; a decoded image whose job is no longer listed here is discarded.
+  std::unordered_map<unsigned int, uint64_t> pendingJobs;
+  uint64_t nextJob;
+
+  TextureLoader();
+
+  PixelBuffer* acquireBuffer();
+  void track(unsigned int textureId, TextureMemory memory);
+  void upload(const DecodedImage& image, PixelBuffer& buffer);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One GPU texture shared by every user of the same image. The texture is deleted when the
+// last handle goes away.
+class TextureResource
+{
+public:
+  unsigned int id;
+  std::string path;
+  uint64_t contentHash;
+  // Every registry path that resolves to this texture, so release() can erase them directly.
+  std::vector<std::string> aliases;
+
+  TextureResource(unsigned int id, std::string path, uint64_t contentHash);
+  ~TextureResource();
+
+  TextureResource(const TextureResource&) = delete;
+  TextureResource& operator=(const TextureResource&) = delete;
+};
+
+using TextureHandle = std::shared_ptr<TextureResource>;
+
+// An image file resolved by TextureRegistry::describe: its canonical path and the size and hash of
+// its bytes (both 0 when it could not be read).
+struct TextureSource
+{
+  std::string path;
+  uint64_t size;
+  uint64_t contentHash;
+};
+
+// Process-wide texture cache keyed by canonical path and by file content, so the same image
+// reached through different paths or models is only uploaded once. GL thread only, except describe().
+class TextureRegistry
+{
+public:
+  static TextureRegistry& shared();
+
+  // Canonicalizes, maps and hashes the file; safe from any thread, so loaders call it on their
+  // workers and keep the GL thread to the lookups in acquire(). Each path is only hashed once.
+  TextureSource describe(const std::string& path);
+
+  TextureHandle acquire(const TextureSource& source, bool generateMipmaps = true);
+  // describe() and acquire() in one go on the calling thread.
+  TextureHandle acquire(const std::string& path, bool generateMipmaps = true);
+
+  // Releases the registry's hold on the GL context; textures released afterwards are not deleted.
+  void shutdown();
+  bool hasContext() const;
+
+  size_t textureCount() const;
+
+private:
+  std::unordered_map<std::string, std::weak_ptr<TextureResource>> byPath;
+  std::unordered_map<uint64_t, std::weak_ptr<TextureResource>> byContent;
+  size_t liveTextures;
+  bool contextAlive;
+
+  std::mutex describeMutex;
+  std::unordered_map<std::string, TextureSource> described;
+
+  friend class TextureResource;
+
+  TextureRegistry();
+
+  void release(const TextureResource& texture);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  explicit ThreadPool(unsigned int numThreads = std::thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Process-wide pool used for asset work that must stay off the GL thread.
+  static ThreadPool& shared();
+
+  unsigned int size() const;
+
+  template <typename F>
+  auto submit(F&& task) -> std::future<decltype(task())>
+  {
+    using Result = decltype(task());
+
+    // std::function needs a copyable target, so the move-only packaged_task is shared.
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->tasks.push([packaged]() { (*packaged)(); });
+    }
+
+    this->condition.notify_one();
+
+    return result;
+  }
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping;
+
+  void workerLoop();
+};
+
+#endif
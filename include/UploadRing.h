@@ -0,0 +1,79 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+constexpr unsigned int UPLOAD_RING_FRAMES = 3;
+constexpr size_t UPLOAD_RING_FRAME_CAPACITY = 4 * 1024 * 1024;
+
+// One frame's slice of the ring. `data` is null when the frame's capacity is exhausted.
+struct UploadAllocation
+{
+  void* data;
+  // Byte offset to bind or draw from inside getBuffer().
+  GLintptr offset;
+  size_t size;
+};
+
+struct UploadRingStats
+{
+  bool persistent = false;
+  size_t frameCapacity = 0;
+  size_t used = 0;
+  size_t peak = 0;
+  // Frames that had to wait for the GPU before their region could be reused.
+  unsigned int fenceWaits = 0;
+  unsigned int overflows = 0;
+};
+
+// Per-frame streaming memory for transforms, particles and debug geometry. With ARB_buffer_storage
+// one buffer stays persistently mapped and each of the in-flight frames owns a region guarded by a
+// fence; on plain GL 3.3 every frame has its own buffer that is orphaned on the frame's first flush, and
+// each flush copies only the bytes staged since the last one into untouched space. allocate() may be called from any thread between beginFrame() and flush(); the rest of the
+// frame cycle runs on the GL thread.
+class UploadRing
+{
+public:
+  static UploadRing& shared();
+
+  // Waits until the GPU is done with the region this frame reuses. Creates the buffers on first use.
+  void beginFrame();
+  UploadAllocation allocate(size_t size, size_t alignment = 16);
+  UploadAllocation upload(const void* data, size_t size, size_t alignment = 16);
+  // Makes everything allocated so far visible to GL; call before drawing from it.
+  void flush();
+  void endFrame();
+
+  GLuint getBuffer() const;
+  // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, for allocations bound with glBindBufferRange.
+  size_t getUniformAlignment() const;
+  UploadRingStats getStats() const;
+
+  // Deletes the buffers while the context is still alive.
+  void shutdown();
+
+private:
+  std::vector<GLuint> buffers;
+  std::vector<GLsync> fences;
+  unsigned char* mapping;
+  std::vector<unsigned char> staging;
+  size_t frameCapacity;
+  size_t uniformAlignment;
+  unsigned int frame;
+  std::atomic<size_t> cursor;
+  size_t flushed;
+  UploadRingStats stats;
+  mutable std::mutex mutex;
+  bool contextAlive;
+
+  UploadRing();
+
+  void create();
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef VERTEX_QUANTIZER_H
+#define VERTEX_QUANTIZER_H
+
+#include "Mesh.h"
+
+namespace Model
+{
+  // Encodes data.vertices as PackedVertex relative to the mesh bounds, releases the float
+  // vertices and records the byte counts before and after in data.stats.
+  void quantizeVertices(MeshData& data);
+
+  PackedVertex packVertex(const Vertex& vertex, const VertexQuantization& quantization);
+  Vertex unpackVertex(const PackedVertex& vertex, const VertexQuantization& quantization);
+}
+
+#endif
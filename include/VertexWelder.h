@@ -0,0 +1,23 @@
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include "ImportArena.h"
+#include "Mesh.h"
+
+namespace Model
+{
+  // Per-component tolerances for treating two vertices as one. All zero welds bitwise-identical vertices only.
+  struct WeldTolerance
+  {
+    float position = 0.0f;
+    float normal = 0.0f;
+    float texCoords = 0.0f;
+  };
+
+  // Merges duplicate vertices through a spatial hash and rewrites the indices. Records the
+  // vertex counts before and after in data.stats. The hash table and remap scratch come from
+  // `arena` when one is given, otherwise from an arena that lives for this call.
+  void weldVertices(MeshData& data, const WeldTolerance& tolerance = WeldTolerance(), ImportArena* arena = nullptr);
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef VIRTUAL_FILE_SYSTEM_H
+#define VIRTUAL_FILE_SYSTEM_H
+
+#include <cstddef>
+#include <string>
+
+#include "MappedFile.h"
+#include "PackFile.h"
+
+// Resolves asset paths against a mounted pack file first and loose files second. Mount before
+// any loading starts; lookups afterwards are read-only and safe from worker threads.
+class VirtualFileSystem
+{
+public:
+  static VirtualFileSystem& shared();
+
+  // Paths inside the pack are relative to `root`, the directory it was built from.
+  bool mount(const std::string& packPath, const std::string& root);
+  bool isMounted() const;
+
+  bool find(const std::string& path, const unsigned char*& data, size_t& size) const;
+  // Faults every page of the asset in so a later read on the GL thread does not wait on the disk.
+  bool prefetch(const std::string& path) const;
+
+private:
+  PackFile pack;
+  std::string root;
+  std::string workingDirectory;
+  bool mounted;
+
+  VirtualFileSystem();
+
+  std::string packPath(const std::string& path) const;
+};
+
+// Where AssetFile::open looks first. Files the app rewrites at runtime (the mesh cache) use LooseFirst,
+// so a fresh loose copy is not shadowed by a stale one shipped in the pack.
+enum class AssetLookup
+{
+  PackFirst,
+  LooseFirst
+};
+
+// Read-only view of one asset: a slice of the mounted pack, or a mapped loose file.
+class AssetFile
+{
+public:
+  AssetFile();
+
+  AssetFile(AssetFile&& other) noexcept;
+  AssetFile& operator=(AssetFile&& other) noexcept;
+
+  bool open(const std::string& path, AssetLookup lookup = AssetLookup::PackFirst);
+  void close();
+
+  bool isOpen() const;
+  const unsigned char* data() const;
+  size_t size() const;
+
+private:
+  MappedFile loose;
+  const unsigned char* view;
+  size_t length;
+};
+
+#endif
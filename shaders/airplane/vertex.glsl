@@ -3,15 +3,27 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texCoords;
+// Index of this draw inside its render queue batch (one per instance, see GeometryHeap::bindDrawIds).
+layout (location = 7) in uint drawId;
 
 out vec2 TexCoords;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "../common/frame.glsl"
+
+// Per-draw transforms streamed by the render queue, four texels per matrix. They already include the
+// packed-position dequantization, so packed and float meshes share the same path.
+uniform samplerBuffer drawTransforms;
+uniform int drawBase;
 
 void main()
 {
-  gl_Position = projection * view * model * vec4(position, 1.0f);
+  int texel = (drawBase + int(drawId)) * 4;
+  mat4 model = mat4(
+    texelFetch(drawTransforms, texel),
+    texelFetch(drawTransforms, texel + 1),
+    texelFetch(drawTransforms, texel + 2),
+    texelFetch(drawTransforms, texel + 3));
+
+  gl_Position = frame.viewProjection * model * vec4(position, 1.0f);
   TexCoords = texCoords;
-}
\ No newline at end of file
+}
@@ -0,0 +1,12 @@
+// Per-frame constants shared by every program, filled by bindFrameConstants (FrameConstants.h).
+// Laid out with std140; keep the order in step with the C++ struct.
+layout (std140) uniform FrameConstants
+{
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec3 cameraPosition;
+  float time;
+  vec3 ambientColour;
+  float ambientStrength;
+} frame;
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 color;
+
+#include "../common/frame.glsl"
+
+// Untextured models such as the low-poly trees are drawn in a single flat colour.
+uniform vec3 baseColour;
+
+void main()
+{
+  color = frame.ambientStrength * vec4(frame.ambientColour * baseColour, 1.0);
+}
@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec2 texCoords;
+// One transform per instance (attribute divisor 1), streamed by Model::drawInstanced.
+layout (location = 3) in mat4 instanceModel;
+
+out vec2 TexCoords;
+
+#include "../common/frame.glsl"
+
+// Packed meshes store positions as unorm16 inside their bounds; float meshes pass offset 0, scale 1.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+void main()
+{
+  vec3 decoded = positionOffset + positionScale * position;
+
+  gl_Position = frame.viewProjection * instanceModel * vec4(decoded, 1.0f);
+  TexCoords = texCoords;
+}
@@ -4,10 +4,11 @@ out vec4 FragColor;
 
 in vec3 TexCoords;
 
+#include "../common/frame.glsl"
+
 uniform samplerCube skybox;
-uniform float ambientStrength;
 
 void main()
 {
-  FragColor = ambientStrength * texture(skybox, TexCoords);
+  FragColor = frame.ambientStrength * texture(skybox, TexCoords);
 }
\ No newline at end of file
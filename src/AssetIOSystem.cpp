@@ -0,0 +1,89 @@
+#include "AssetIOSystem.h"
+
+#include <cstring>
+
+namespace Model
+{
+  AssetIOStream::AssetIOStream(AssetFile&& file):
+    file(std::move(file)),
+    position(0)
+  {
+  }
+
+  size_t AssetIOStream::Read(void* buffer, size_t size, size_t count)
+  {
+    if (size == 0 || count == 0) return 0;
+
+    size_t available = (this->file.size() - this->position) / size;
+    if (count > available) count = available;
+
+    std::memcpy(buffer, this->file.data() + this->position, size * count);
+    this->position += size * count;
+
+    return count;
+  }
+
+  size_t AssetIOStream::Write(const void*, size_t, size_t)
+  {
+    return 0;
+  }
+
+  aiReturn AssetIOStream::Seek(size_t offset, aiOrigin origin)
+  {
+    size_t target;
+    switch (origin)
+    {
+    case aiOrigin_SET: target = offset; break;
+    case aiOrigin_CUR: target = this->position + offset; break;
+    case aiOrigin_END: target = this->file.size() - offset; break;
+    default: return aiReturn_FAILURE;
+    }
+
+    if (target > this->file.size()) return aiReturn_FAILURE;
+
+    this->position = target;
+
+    return aiReturn_SUCCESS;
+  }
+
+  size_t AssetIOStream::Tell() const
+  {
+    return this->position;
+  }
+
+  size_t AssetIOStream::FileSize() const
+  {
+    return this->file.size();
+  }
+
+  void AssetIOStream::Flush()
+  {
+  }
+
+  bool AssetIOSystem::Exists(const char* path) const
+  {
+    AssetFile file;
+
+    return file.open(path);
+  }
+
+  char AssetIOSystem::getOsSeparator() const
+  {
+    return '/';
+  }
+
+  Assimp::IOStream* AssetIOSystem::Open(const char* path, const char* mode)
+  {
+    if (std::strchr(mode, 'w') || std::strchr(mode, 'a')) return nullptr;
+
+    AssetFile file;
+    if (!file.open(path)) return nullptr;
+
+    return new AssetIOStream(std::move(file));
+  }
+
+  void AssetIOSystem::Close(Assimp::IOStream* stream)
+  {
+    delete stream;
+  }
+}
@@ -0,0 +1,666 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <iostream>
+
+#include "ThreadPool.h"
+
+// The encoders are written as fixed-size loops over the 16 texels of a block so the compiler can
+// vectorize them for whichever SIMD unit the target has (SSE/AVX on x86, NEON on Apple silicon).
+
+static const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+size_t compressedSize(unsigned int width, unsigned int height, BlockFormat format)
+{
+  return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+/* ---------- Shared helpers ---------- */
+
+// Principal axis of the block's colours by power iteration on the covariance matrix.
+template <int Channels>
+static void principalAxis(const float texels[16][4], const float mean[4], float axis[4])
+{
+  float covariance[Channels][Channels] = {};
+
+  for (int i = 0; i < 16; i++)
+  {
+    for (int a = 0; a < Channels; a++)
+    {
+      for (int b = 0; b < Channels; b++)
+      {
+        covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+      }
+    }
+  }
+
+  for (int c = 0; c < 4; c++) axis[c] = c < Channels ? 1.0f : 0.0f;
+
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[4] = {};
+    for (int a = 0; a < Channels; a++)
+    {
+      for (int b = 0; b < Channels; b++)
+      {
+        next[a] += covariance[a][b] * axis[b];
+      }
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < Channels; c++) length = std::max(length, std::fabs(next[c]));
+    if (length < 1e-6f) break;
+
+    for (int c = 0; c < Channels; c++) axis[c] = next[c] / length;
+  }
+}
+
+template <int Channels>
+static void fitEndpoints(const float texels[16][4], float low[4], float high[4])
+{
+  float mean[4] = {};
+  for (int i = 0; i < 16; i++)
+  {
+    for (int c = 0; c < Channels; c++) mean[c] += texels[i][c] / 16.0f;
+  }
+
+  float axis[4];
+  principalAxis<Channels>(texels, mean, axis);
+
+  float minProjection = 0.0f, maxProjection = 0.0f;
+  for (int i = 0; i < 16; i++)
+  {
+    float projection = 0.0f;
+    for (int c = 0; c < Channels; c++) projection += (texels[i][c] - mean[c]) * axis[c];
+
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  float axisLength = 0.0f;
+  for (int c = 0; c < Channels; c++) axisLength += axis[c] * axis[c];
+  if (axisLength < 1e-12f) axisLength = 1.0f;
+
+  for (int c = 0; c < 4; c++)
+  {
+    float value = c < Channels ? mean[c] : 255.0f;
+    float direction = c < Channels ? axis[c] / axisLength : 0.0f;
+
+    low[c] = std::clamp(value + minProjection * direction, 0.0f, 255.0f);
+    high[c] = std::clamp(value + maxProjection * direction, 0.0f, 255.0f);
+  }
+}
+
+static void loadBlock(const unsigned char* rgba, float texels[16][4])
+{
+  for (int i = 0; i < 16; i++)
+  {
+    for (int c = 0; c < 4; c++) texels[i][c] = rgba[i * 4 + c];
+  }
+}
+
+/* ---------- BC1 ---------- */
+
+static uint16_t packRGB565(const float colour[4])
+{
+  int r = std::clamp(static_cast<int>(std::lround(colour[0] * 31.0f / 255.0f)), 0, 31);
+  int g = std::clamp(static_cast<int>(std::lround(colour[1] * 63.0f / 255.0f)), 0, 63);
+  int b = std::clamp(static_cast<int>(std::lround(colour[2] * 31.0f / 255.0f)), 0, 31);
+
+  return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int colour[3])
+{
+  int r = (packed >> 11) & 31;
+  int g = (packed >> 5) & 63;
+  int b = packed & 31;
+
+  colour[0] = (r << 3) | (r >> 2);
+  colour[1] = (g << 2) | (g >> 4);
+  colour[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1Palette(uint16_t c0, uint16_t c1, bool fourColour, int palette[4][4])
+{
+  unpackRGB565(c0, palette[0]);
+  unpackRGB565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = 255;
+
+  for (int c = 0; c < 3; c++)
+  {
+    if (fourColour)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    else
+    {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+
+  palette[2][3] = 255;
+  palette[3][3] = fourColour ? 255 : 0;
+}
+
+// Picks the nearest of the four colours per texel; returns the packed indices and the total error.
+static uint32_t bc1Indices(const float texels[16][4], uint16_t c0, uint16_t c1, float& error)
+{
+  int palette[4][4];
+  bc1Palette(c0, c1, true, palette);
+
+  uint32_t indices = 0;
+  error = 0.0f;
+
+  for (int i = 0; i < 16; i++)
+  {
+    float best = 1e30f;
+    uint32_t bestIndex = 0;
+
+    for (uint32_t p = 0; p < 4; p++)
+    {
+      float dr = texels[i][0] - palette[p][0];
+      float dg = texels[i][1] - palette[p][1];
+      float db = texels[i][2] - palette[p][2];
+      float distance = dr * dr + dg * dg + db * db;
+
+      if (distance < best)
+      {
+        best = distance;
+        bestIndex = p;
+      }
+    }
+
+    indices |= bestIndex << (2 * i);
+    error += best;
+  }
+
+  return indices;
+}
+
+// Least-squares endpoints for a fixed index assignment.
+static bool refineBC1(const float texels[16][4], uint32_t indices, float low[4], float high[4])
+{
+  static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[3] = {}, bx[3] = {};
+
+  for (int i = 0; i < 16; i++)
+  {
+    float a = weights[(indices >> (2 * i)) & 3];
+    float b = 1.0f - a;
+
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+
+    for (int c = 0; c < 3; c++)
+    {
+      ax[c] += a * texels[i][c];
+      bx[c] += b * texels[i][c];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) return false;
+
+  for (int c = 0; c < 3; c++)
+  {
+    high[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+    low[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+  }
+
+  return true;
+}
+
+static void encodeColourBlock(const float texels[16][4], unsigned char* out)
+{
+  float low[4], high[4];
+  fitEndpoints<3>(texels, low, high);
+
+  uint16_t c0 = packRGB565(high);
+  uint16_t c1 = packRGB565(low);
+
+  float error;
+  uint32_t indices = bc1Indices(texels, c0, c1, error);
+
+  if (refineBC1(texels, indices, low, high))
+  {
+    uint16_t r0 = packRGB565(high);
+    uint16_t r1 = packRGB565(low);
+
+    float refinedError;
+    uint32_t refined = bc1Indices(texels, r0, r1, refinedError);
+
+    if (refinedError < error)
+    {
+      c0 = r0;
+      c1 = r1;
+      indices = refined;
+    }
+  }
+
+  // Four-colour mode requires c0 > c1; swapping the endpoints maps index i to {1, 0, 3, 2}.
+  if (c0 < c1)
+  {
+    std::swap(c0, c1);
+    indices ^= 0x55555555u;
+  }
+  else if (c0 == c1)
+  {
+    indices = 0;
+  }
+
+  out[0] = c0 & 0xff;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xff;
+  out[3] = c1 >> 8;
+  std::memcpy(out + 4, &indices, 4);
+}
+
+void encodeBC1Block(const unsigned char* rgba, unsigned char* out)
+{
+  float texels[16][4];
+  loadBlock(rgba, texels);
+
+  encodeColourBlock(texels, out);
+}
+
+void decodeBC1Block(const unsigned char* block, unsigned char* rgba)
+{
+  uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+  uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+  uint32_t indices;
+  std::memcpy(&indices, block + 4, 4);
+
+  int palette[4][4];
+  bc1Palette(c0, c1, c0 > c1, palette);
+
+  for (int i = 0; i < 16; i++)
+  {
+    const int* colour = palette[(indices >> (2 * i)) & 3];
+    for (int c = 0; c < 4; c++) rgba[i * 4 + c] = static_cast<unsigned char>(colour[c]);
+  }
+}
+
+/* ---------- BC3 ---------- */
+
+static void alphaPalette(int a0, int a1, int palette[8])
+{
+  palette[0] = a0;
+  palette[1] = a1;
+
+  if (a0 > a1)
+  {
+    for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+  }
+  else
+  {
+    for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static void encodeAlphaBlock(const unsigned char* rgba, unsigned char* out)
+{
+  int a0 = 0, a1 = 255;
+  for (int i = 0; i < 16; i++)
+  {
+    a0 = std::max(a0, static_cast<int>(rgba[i * 4 + 3]));
+    a1 = std::min(a1, static_cast<int>(rgba[i * 4 + 3]));
+  }
+
+  out[0] = static_cast<unsigned char>(a0);
+  out[1] = static_cast<unsigned char>(a1);
+
+  uint64_t indices = 0;
+
+  if (a0 > a1)
+  {
+    int palette[8];
+    alphaPalette(a0, a1, palette);
+
+    for (int i = 0; i < 16; i++)
+    {
+      int alpha = rgba[i * 4 + 3];
+      int best = 0;
+
+      for (int p = 1; p < 8; p++)
+      {
+        if (std::abs(palette[p] - alpha) < std::abs(palette[best] - alpha)) best = p;
+      }
+
+      indices |= static_cast<uint64_t>(best) << (3 * i);
+    }
+  }
+
+  for (int i = 0; i < 6; i++) out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+}
+
+void encodeBC3Block(const unsigned char* rgba, unsigned char* out)
+{
+  float texels[16][4];
+  loadBlock(rgba, texels);
+
+  encodeAlphaBlock(rgba, out);
+  encodeColourBlock(texels, out + 8);
+}
+
+void decodeBC3Block(const unsigned char* block, unsigned char* rgba)
+{
+  int palette[8];
+  alphaPalette(block[0], block[1], palette);
+
+  uint64_t alphaIndices = 0;
+  for (int i = 0; i < 6; i++) alphaIndices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+
+  // The colour half of BC3 is always decoded in four-colour mode.
+  uint16_t c0 = static_cast<uint16_t>(block[8] | (block[9] << 8));
+  uint16_t c1 = static_cast<uint16_t>(block[10] | (block[11] << 8));
+  uint32_t indices;
+  std::memcpy(&indices, block + 12, 4);
+
+  int colours[4][4];
+  bc1Palette(c0, c1, true, colours);
+
+  for (int i = 0; i < 16; i++)
+  {
+    const int* colour = colours[(indices >> (2 * i)) & 3];
+    for (int c = 0; c < 3; c++) rgba[i * 4 + c] = static_cast<unsigned char>(colour[c]);
+
+    rgba[i * 4 + 3] = static_cast<unsigned char>(palette[(alphaIndices >> (3 * i)) & 7]);
+  }
+}
+
+/* ---------- BC7 (mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit, 4-bit indices) ---------- */
+
+class BitWriter
+{
+public:
+  unsigned char* out;
+  unsigned int position;
+
+  void write(uint32_t value, unsigned int bits)
+  {
+    for (unsigned int i = 0; i < bits; i++, this->position++)
+    {
+      if (value & (1u << i)) this->out[this->position / 8] |= static_cast<unsigned char>(1u << (this->position % 8));
+    }
+  }
+};
+
+class BitReader
+{
+public:
+  const unsigned char* in;
+  unsigned int position;
+
+  uint32_t read(unsigned int bits)
+  {
+    uint32_t value = 0;
+    for (unsigned int i = 0; i < bits; i++, this->position++)
+    {
+      value |= static_cast<uint32_t>((this->in[this->position / 8] >> (this->position % 8)) & 1) << i;
+    }
+
+    return value;
+  }
+};
+
+// Chooses 7-bit endpoint channels and the shared p-bit that best reproduce the 8-bit target.
+static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit)
+{
+  float bestError = 1e30f;
+
+  for (int p = 0; p < 2; p++)
+  {
+    int candidate[4];
+    float error = 0.0f;
+
+    for (int c = 0; c < 4; c++)
+    {
+      candidate[c] = std::clamp(static_cast<int>(std::lround((endpoint[c] - p) / 2.0f)), 0, 127);
+
+      float decoded = static_cast<float>((candidate[c] << 1) | p);
+      error += (decoded - endpoint[c]) * (decoded - endpoint[c]);
+    }
+
+    if (error < bestError)
+    {
+      bestError = error;
+      pBit = p;
+      std::copy(candidate, candidate + 4, quantized);
+    }
+  }
+}
+
+static float bc7Indices(const float texels[16][4], const int e0[4], const int e1[4], int indices[16])
+{
+  int palette[16][4];
+  for (int w = 0; w < 16; w++)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      palette[w][c] = ((64 - BC7_WEIGHTS4[w]) * e0[c] + BC7_WEIGHTS4[w] * e1[c] + 32) >> 6;
+    }
+  }
+
+  float error = 0.0f;
+
+  for (int i = 0; i < 16; i++)
+  {
+    float best = 1e30f;
+
+    for (int w = 0; w < 16; w++)
+    {
+      float distance = 0.0f;
+      for (int c = 0; c < 4; c++)
+      {
+        float d = texels[i][c] - palette[w][c];
+        distance += d * d;
+      }
+
+      if (distance < best)
+      {
+        best = distance;
+        indices[i] = w;
+      }
+    }
+
+    error += best;
+  }
+
+  return error;
+}
+
+void encodeBC7Block(const unsigned char* rgba, unsigned char* out)
+{
+  float texels[16][4];
+  loadBlock(rgba, texels);
+
+  float low[4], high[4];
+  fitEndpoints<4>(texels, low, high);
+
+  int q0[4], q1[4], p0, p1;
+  quantizeBC7Endpoint(low, q0, p0);
+  quantizeBC7Endpoint(high, q1, p1);
+
+  int e0[4], e1[4];
+  for (int c = 0; c < 4; c++)
+  {
+    e0[c] = (q0[c] << 1) | p0;
+    e1[c] = (q1[c] << 1) | p1;
+  }
+
+  int indices[16];
+  bc7Indices(texels, e0, e1, indices);
+
+  // The anchor texel stores only three index bits, so its index must be below 8.
+  if (indices[0] >= 8)
+  {
+    std::swap(q0, q1);
+    std::swap(p0, p1);
+    for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+  }
+
+  std::memset(out, 0, 16);
+  BitWriter writer = { out, 0 };
+
+  writer.write(1u << 6, 7);
+
+  for (int c = 0; c < 4; c++)
+  {
+    writer.write(q0[c], 7);
+    writer.write(q1[c], 7);
+  }
+
+  writer.write(p0, 1);
+  writer.write(p1, 1);
+
+  for (int i = 0; i < 16; i++)
+  {
+    writer.write(indices[i], i == 0 ? 3 : 4);
+  }
+}
+
+bool decodeBC7Block(const unsigned char* block, unsigned char* rgba)
+{
+  if ((block[0] & 0x7f) != 0x40)
+  {
+    // Only mode 6 is produced by the cooker; flag anything else in magenta.
+    for (int i = 0; i < 16; i++)
+    {
+      rgba[i * 4 + 0] = 255;
+      rgba[i * 4 + 1] = 0;
+      rgba[i * 4 + 2] = 255;
+      rgba[i * 4 + 3] = 255;
+    }
+
+    return false;
+  }
+
+  BitReader reader = { block, 7 };
+
+  int q0[4], q1[4];
+  for (int c = 0; c < 4; c++)
+  {
+    q0[c] = static_cast<int>(reader.read(7));
+    q1[c] = static_cast<int>(reader.read(7));
+  }
+
+  int p0 = static_cast<int>(reader.read(1));
+  int p1 = static_cast<int>(reader.read(1));
+
+  for (int i = 0; i < 16; i++)
+  {
+    int weight = BC7_WEIGHTS4[reader.read(i == 0 ? 3 : 4)];
+
+    for (int c = 0; c < 4; c++)
+    {
+      int e0 = (q0[c] << 1) | p0;
+      int e1 = (q1[c] << 1) | p1;
+      rgba[i * 4 + c] = static_cast<unsigned char>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+    }
+  }
+
+  return true;
+}
+
+/* ---------- Whole images ---------- */
+
+static void compressBlockRow(const unsigned char* rgba, unsigned int width, unsigned int height, unsigned int blockY, BlockFormat format, unsigned char* out)
+{
+  unsigned int blocksWide = (width + 3) / 4;
+  unsigned char texels[64];
+
+  for (unsigned int blockX = 0; blockX < blocksWide; blockX++)
+  {
+    for (unsigned int y = 0; y < 4; y++)
+    {
+      unsigned int sourceY = std::min(blockY * 4 + y, height - 1);
+
+      for (unsigned int x = 0; x < 4; x++)
+      {
+        unsigned int sourceX = std::min(blockX * 4 + x, width - 1);
+        std::memcpy(&texels[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sourceY) * width + sourceX) * 4], 4);
+      }
+    }
+
+    unsigned char* block = out + blockX * blockBytes(format);
+
+    switch (format)
+    {
+    case BlockFormat::BC1: encodeBC1Block(texels, block); break;
+    case BlockFormat::BC3: encodeBC3Block(texels, block); break;
+    case BlockFormat::BC7: encodeBC7Block(texels, block); break;
+    }
+  }
+}
+
+std::vector<unsigned char> compressImage(const unsigned char* rgba, unsigned int width, unsigned int height, BlockFormat format)
+{
+  std::vector<unsigned char> blocks(compressedSize(width, height, format));
+
+  unsigned int blocksHigh = (height + 3) / 4;
+  size_t rowBytes = static_cast<size_t>((width + 3) / 4) * blockBytes(format);
+
+  std::vector<std::future<void>> rows;
+  for (unsigned int blockY = 0; blockY < blocksHigh; blockY++)
+  {
+    unsigned char* out = blocks.data() + blockY * rowBytes;
+    rows.push_back(ThreadPool::shared().submit([=]() { compressBlockRow(rgba, width, height, blockY, format, out); }));
+  }
+
+  for (std::future<void>& row : rows) row.get();
+
+  return blocks;
+}
+
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, unsigned int width, unsigned int height, BlockFormat format)
+{
+  std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+
+  unsigned int blocksWide = (width + 3) / 4;
+  unsigned int blocksHigh = (height + 3) / 4;
+  unsigned char texels[64];
+  bool unsupportedBlocks = false;
+
+  for (unsigned int blockY = 0; blockY < blocksHigh; blockY++)
+  {
+    for (unsigned int blockX = 0; blockX < blocksWide; blockX++)
+    {
+      const unsigned char* block = blocks + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes(format);
+
+      switch (format)
+      {
+      case BlockFormat::BC1: decodeBC1Block(block, texels); break;
+      case BlockFormat::BC3: decodeBC3Block(block, texels); break;
+      case BlockFormat::BC7: unsupportedBlocks |= !decodeBC7Block(block, texels); break;
+      }
+
+      for (unsigned int y = 0; y < 4 && blockY * 4 + y < height; y++)
+      {
+        for (unsigned int x = 0; x < 4 && blockX * 4 + x < width; x++)
+        {
+          size_t target = (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4;
+          std::memcpy(&rgba[target], &texels[(y * 4 + x) * 4], 4);
+        }
+      }
+    }
+  }
+
+  if (unsupportedBlocks)
+  {
+    std::cerr << "Error: BC7 fallback decoder only supports mode 6 blocks" << std::endl;
+  }
+
+  return rgba;
+}
@@ -0,0 +1,25 @@
+#include "FrameConstants.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+#include "UploadRing.h"
+
+bool bindFrameConstants(const FrameConstants& constants)
+{
+  UploadRing& ring = UploadRing::shared();
+
+  UploadAllocation allocation = ring.upload(&constants, sizeof(constants), ring.getUniformAlignment());
+  if (!allocation.data)
+  {
+    std::cerr << "ERROR: No upload ring space left for the frame constants." << std::endl;
+    return false;
+  }
+
+  // The fallback path only copies to the GPU buffer on flush.
+  ring.flush();
+  glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, ring.getBuffer(), allocation.offset, static_cast<GLsizeiptr>(allocation.size));
+
+  return true;
+}
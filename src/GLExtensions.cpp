@@ -0,0 +1,85 @@
+#include "GLExtensions.h"
+
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+
+GLExtensions::GLExtensions():
+  textureCompressionS3TC(false),
+  textureCompressionBPTC(false),
+  textureStorage(false),
+  persistentMapping(false),
+  multiDrawIndirect(false),
+  texStorage2D(nullptr),
+  bufferStorage(nullptr),
+  multiDrawElementsIndirect(nullptr)
+{
+}
+
+GLExtensions& GLExtensions::instance()
+{
+  static GLExtensions extensions;
+  return extensions;
+}
+
+const GLExtensions& GLExtensions::get()
+{
+  return instance();
+}
+
+void GLExtensions::load()
+{
+  GLExtensions& extensions = instance();
+
+  bool atLeast42 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 2);
+
+  extensions.textureCompressionS3TC = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+  extensions.textureCompressionBPTC = atLeast42 || glfwExtensionSupported("GL_ARB_texture_compression_bptc");
+
+  if (atLeast42 || glfwExtensionSupported("GL_ARB_texture_storage"))
+  {
+    extensions.texStorage2D = reinterpret_cast<PFNGLTEXSTORAGE2DPROC>(glfwGetProcAddress("glTexStorage2D"));
+  }
+
+  extensions.textureStorage = extensions.texStorage2D != nullptr;
+
+  bool atLeast44 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+  if (atLeast44 || glfwExtensionSupported("GL_ARB_buffer_storage"))
+  {
+    extensions.bufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+  }
+
+  extensions.persistentMapping = extensions.bufferStorage != nullptr;
+
+  bool atLeast43 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+  if (atLeast43 || (glfwExtensionSupported("GL_ARB_multi_draw_indirect") && glfwExtensionSupported("GL_ARB_base_instance")))
+  {
+    extensions.multiDrawElementsIndirect = reinterpret_cast<PFNGLMULTIDRAWELEMENTSINDIRECTPROC>(glfwGetProcAddress("glMultiDrawElementsIndirect"));
+  }
+
+  extensions.multiDrawIndirect = extensions.multiDrawElementsIndirect != nullptr;
+
+  std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor
+    << " | S3TC: " << (extensions.textureCompressionS3TC ? "yes" : "no")
+    << " | BPTC: " << (extensions.textureCompressionBPTC ? "yes" : "no")
+    << " | Texture storage: " << (extensions.textureStorage ? "yes" : "no")
+    << " | Buffer storage: " << (extensions.persistentMapping ? "yes" : "no")
+    << " | Multi-draw indirect: " << (extensions.multiDrawIndirect ? "yes" : "no") << std::endl;
+}
+
+bool GLExtensions::supportsCompressedFormat(unsigned int internalFormat) const
+{
+  switch (internalFormat)
+  {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    return this->textureCompressionS3TC;
+  case GL_COMPRESSED_RGBA_BPTC_UNORM:
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+    return this->textureCompressionBPTC;
+  default:
+    return false;
+  }
+}
@@ -0,0 +1,422 @@
+#include "GeometryHeap.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "Mesh.h"
+
+namespace Model
+{
+  static uint64_t alignIndexBytes(uint64_t bytes)
+  {
+    return (bytes + GEOMETRY_INDEX_ALIGNMENT - 1) & ~(GEOMETRY_INDEX_ALIGNMENT - 1);
+  }
+
+  GeometryHeap& GeometryHeap::shared()
+  {
+    static GeometryHeap heap;
+
+    return heap;
+  }
+
+  GeometryHeap::GeometryHeap():
+    boundVertexArray(0),
+    contextAlive(true)
+  {
+  }
+
+  GeometryHeap::Pool& GeometryHeap::getPool(VertexFormat format)
+  {
+    return this->pools[static_cast<uint32_t>(format)];
+  }
+
+  GeometryHandle GeometryHeap::allocate(VertexFormat format, const void* vertices, size_t vertexCount, const void* indices, size_t indexBytes)
+  {
+    Pool& pool = this->getPool(format);
+
+    if (pool.vertexArray == 0)
+    {
+      pool.stride = format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+      this->createBuffers(pool, format, std::max<uint64_t>(GEOMETRY_INITIAL_VERTICES, vertexCount), std::max<uint64_t>(GEOMETRY_INITIAL_INDEX_BYTES, alignIndexBytes(indexBytes)));
+    }
+
+    uint64_t alignedIndexBytes = alignIndexBytes(indexBytes);
+    uint64_t vertexOffset, indexOffset;
+
+    if (!pool.vertices.allocate(vertexCount, vertexOffset))
+    {
+      this->growPool(pool, format, std::max(pool.vertices.getCapacity() * 2, pool.vertices.getCapacity() + vertexCount), pool.indices.getCapacity());
+      pool.vertices.allocate(vertexCount, vertexOffset);
+    }
+
+    if (!pool.indices.allocate(alignedIndexBytes, indexOffset))
+    {
+      this->growPool(pool, format, pool.vertices.getCapacity(), std::max(pool.indices.getCapacity() * 2, pool.indices.getCapacity() + alignedIndexBytes));
+      pool.indices.allocate(alignedIndexBytes, indexOffset);
+    }
+
+    // The copy targets leave the element array binding of whichever VAO is bound untouched.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * pool.stride, vertexCount * pool.stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, indexBytes, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    GeometryRange range;
+    range.format = format;
+    range.baseVertex = static_cast<uint32_t>(vertexOffset);
+    range.vertexCount = static_cast<uint32_t>(vertexCount);
+    range.indexOffset = indexOffset;
+    range.indexBytes = alignedIndexBytes;
+
+    GeometryHandle handle;
+    if (!this->freeHandles.empty())
+    {
+      handle = this->freeHandles.back();
+      this->freeHandles.pop_back();
+      this->ranges[handle] = range;
+      this->live[handle] = true;
+    }
+    else
+    {
+      handle = static_cast<GeometryHandle>(this->ranges.size());
+      this->ranges.push_back(range);
+      this->live.push_back(true);
+    }
+
+    pool.allocations++;
+
+    return handle;
+  }
+
+  void GeometryHeap::free(GeometryHandle handle)
+  {
+    if (handle >= this->ranges.size() || !this->live[handle]) return;
+
+    const GeometryRange& range = this->ranges[handle];
+    Pool& pool = this->getPool(range.format);
+
+    pool.vertices.free(range.baseVertex, range.vertexCount);
+    pool.indices.free(range.indexOffset, range.indexBytes);
+    pool.allocations--;
+
+    this->live[handle] = false;
+    this->freeHandles.push_back(handle);
+
+    if (this->contextAlive && pool.allocations > 0 &&
+      std::max(pool.vertices.getFragmentation(), pool.indices.getFragmentation()) > GEOMETRY_DEFRAGMENT_THRESHOLD)
+    {
+      this->defragment(range.format);
+    }
+  }
+
+  const GeometryRange& GeometryHeap::getRange(GeometryHandle handle) const
+  {
+    return this->ranges[handle];
+  }
+
+  void GeometryHeap::bind(VertexFormat format)
+  {
+    GLuint vertexArray = this->getPool(format).vertexArray;
+    if (vertexArray == this->boundVertexArray) return;
+
+    glBindVertexArray(vertexArray);
+    this->boundVertexArray = vertexArray;
+  }
+
+  void GeometryHeap::bindInstanced(VertexFormat format, GLuint buffer, GLintptr offset)
+  {
+    Pool& pool = this->getPool(format);
+
+    if (pool.instanceArray != this->boundVertexArray)
+    {
+      glBindVertexArray(pool.instanceArray);
+      this->boundVertexArray = pool.instanceArray;
+    }
+
+    if (pool.instanceBuffer == buffer && pool.instanceOffset == offset) return;
+
+    // Without base instance (GL 4.2) the attribute pointers are the only way to start at `offset`.
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint column = 0; column < 4; column++)
+    {
+      glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<const void*>(offset + column * sizeof(glm::vec4)));
+      glEnableVertexAttribArray(INSTANCE_TRANSFORM_LOCATION + column);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    pool.instanceBuffer = buffer;
+    pool.instanceOffset = offset;
+  }
+
+  void GeometryHeap::bindDrawIds(VertexFormat format, GLuint buffer, GLintptr offset)
+  {
+    Pool& pool = this->getPool(format);
+
+    if (pool.drawIdArray != this->boundVertexArray)
+    {
+      glBindVertexArray(pool.drawIdArray);
+      this->boundVertexArray = pool.drawIdArray;
+    }
+
+    if (pool.drawIdBuffer == buffer && pool.drawIdOffset == offset) return;
+
+    if (buffer == 0)
+    {
+      glDisableVertexAttribArray(DRAW_ID_LOCATION);
+    }
+    else
+    {
+      glBindBuffer(GL_ARRAY_BUFFER, buffer);
+      glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), reinterpret_cast<const void*>(offset));
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glEnableVertexAttribArray(DRAW_ID_LOCATION);
+    }
+
+    pool.drawIdBuffer = buffer;
+    pool.drawIdOffset = offset;
+  }
+
+  void GeometryHeap::invalidateBinding()
+  {
+    this->boundVertexArray = 0;
+  }
+
+  void GeometryHeap::defragment(VertexFormat format)
+  {
+    Pool& pool = this->getPool(format);
+    if (pool.vertexArray == 0 || !this->contextAlive) return;
+
+    std::vector<GeometryHandle> handles;
+    for (GeometryHandle handle = 0; handle < this->ranges.size(); handle++)
+    {
+      if (this->live[handle] && this->ranges[handle].format == format) handles.push_back(handle);
+    }
+
+    GLuint oldVertexBuffer = pool.vertexBuffer;
+    GLuint oldIndexBuffer = pool.indexBuffer;
+    this->deleteVertexArrays(pool);
+
+    this->createBuffers(pool, format, pool.vertices.getCapacity(), pool.indices.getCapacity());
+
+    // Copy vertex and index ranges separately, each in offset order, packing them to the front.
+    std::sort(handles.begin(), handles.end(), [this](GeometryHandle a, GeometryHandle b) { return this->ranges[a].baseVertex < this->ranges[b].baseVertex; });
+
+    glBindBuffer(GL_COPY_READ_BUFFER, oldVertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+
+    uint64_t vertexEnd = 0;
+    for (GeometryHandle handle : handles)
+    {
+      GeometryRange& range = this->ranges[handle];
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.baseVertex * pool.stride, vertexEnd * pool.stride, range.vertexCount * pool.stride);
+      range.baseVertex = static_cast<uint32_t>(vertexEnd);
+      vertexEnd += range.vertexCount;
+    }
+
+    std::sort(handles.begin(), handles.end(), [this](GeometryHandle a, GeometryHandle b) { return this->ranges[a].indexOffset < this->ranges[b].indexOffset; });
+
+    glBindBuffer(GL_COPY_READ_BUFFER, oldIndexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+
+    uint64_t indexEnd = 0;
+    for (GeometryHandle handle : handles)
+    {
+      GeometryRange& range = this->ranges[handle];
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, range.indexOffset, indexEnd, range.indexBytes);
+      range.indexOffset = indexEnd;
+      indexEnd += range.indexBytes;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &oldVertexBuffer);
+    glDeleteBuffers(1, &oldIndexBuffer);
+
+    pool.vertices.reset(pool.vertices.getCapacity(), vertexEnd);
+    pool.indices.reset(pool.indices.getCapacity(), indexEnd);
+    pool.defragmentations++;
+  }
+
+  GeometryPoolStats GeometryHeap::getStats(VertexFormat format) const
+  {
+    const Pool& pool = this->pools[static_cast<uint32_t>(format)];
+
+    GeometryPoolStats stats;
+    stats.vertexCapacity = pool.vertices.getCapacity() * pool.stride;
+    stats.vertexUsed = pool.vertices.getUsed() * pool.stride;
+    stats.indexCapacity = pool.indices.getCapacity();
+    stats.indexUsed = pool.indices.getUsed();
+    stats.allocations = pool.allocations;
+    stats.freeBlocks = pool.vertices.getFreeBlockCount() + pool.indices.getFreeBlockCount();
+    stats.fragmentation = std::max(pool.vertices.getFragmentation(), pool.indices.getFragmentation());
+    stats.defragmentations = pool.defragmentations;
+
+    return stats;
+  }
+
+  void GeometryHeap::shutdown()
+  {
+    for (Pool& pool : this->pools)
+    {
+      if (pool.vertexArray == 0) continue;
+
+      this->deleteVertexArrays(pool);
+      glDeleteBuffers(1, &pool.vertexBuffer);
+      glDeleteBuffers(1, &pool.indexBuffer);
+      pool.vertexBuffer = pool.indexBuffer = 0;
+    }
+
+    this->boundVertexArray = 0;
+    this->contextAlive = false;
+  }
+
+  void GeometryHeap::createBuffers(Pool& pool, VertexFormat format, uint64_t vertexCapacity, uint64_t indexCapacity)
+  {
+    glGenVertexArrays(1, &pool.vertexArray);
+    glGenVertexArrays(1, &pool.instanceArray);
+    glGenVertexArrays(1, &pool.drawIdArray);
+    glGenBuffers(1, &pool.vertexBuffer);
+    glGenBuffers(1, &pool.indexBuffer);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * pool.stride, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (pool.vertices.getCapacity() == 0) pool.vertices.reset(vertexCapacity, 0);
+    if (pool.indices.getCapacity() == 0) pool.indices.reset(indexCapacity, 0);
+
+    this->setupVertexArray(pool, format, pool.vertexArray);
+    this->setupVertexArray(pool, format, pool.instanceArray);
+    this->setupVertexArray(pool, format, pool.drawIdArray);
+
+    // Each VAO only ever enables its own per-instance attributes, so neither draws from an array without a buffer.
+    // The transform columns are enabled by the first bindInstanced, once they have a source.
+    glBindVertexArray(pool.instanceArray);
+    for (GLuint column = 0; column < 4; column++)
+    {
+      glVertexAttribDivisor(INSTANCE_TRANSFORM_LOCATION + column, 1);
+    }
+    glBindVertexArray(pool.drawIdArray);
+    glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+    glBindVertexArray(0);
+
+    pool.instanceBuffer = 0;
+    pool.instanceOffset = -1;
+    pool.drawIdBuffer = 0;
+    pool.drawIdOffset = -1;
+  }
+
+  void GeometryHeap::setupVertexArray(Pool& pool, VertexFormat format, GLuint vertexArray)
+  {
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.indexBuffer);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+
+    if (format == VertexFormat::Packed)
+    {
+      // Normalized fetch turns the integers back into [0, 1] / [-1, 1]; the shader applies the bounds.
+      glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+      glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+      glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+    }
+    else
+    {
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    this->invalidateBinding();
+  }
+
+  void GeometryHeap::deleteVertexArrays(Pool& pool)
+  {
+    glDeleteVertexArrays(1, &pool.vertexArray);
+    glDeleteVertexArrays(1, &pool.instanceArray);
+    glDeleteVertexArrays(1, &pool.drawIdArray);
+    pool.vertexArray = pool.instanceArray = pool.drawIdArray = 0;
+    this->invalidateBinding();
+  }
+
+  void GeometryHeap::growPool(Pool& pool, VertexFormat format, uint64_t vertexCapacity, uint64_t indexCapacity)
+  {
+    GLuint oldVertexBuffer = pool.vertexBuffer;
+    GLuint oldIndexBuffer = pool.indexBuffer;
+    uint64_t oldVertexCapacity = pool.vertices.getCapacity();
+    uint64_t oldIndexCapacity = pool.indices.getCapacity();
+
+    this->deleteVertexArrays(pool);
+    this->createBuffers(pool, format, vertexCapacity, indexCapacity);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, oldVertexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.vertexBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldVertexCapacity * pool.stride);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, oldIndexBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.indexBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldIndexCapacity);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &oldVertexBuffer);
+    glDeleteBuffers(1, &oldIndexBuffer);
+
+    pool.vertices.grow(vertexCapacity);
+    pool.indices.grow(indexCapacity);
+
+    std::cout << "Geometry heap grown to " << vertexCapacity * pool.stride / (1024.0 * 1024.0) << " MB vertices, "
+      << indexCapacity / (1024.0 * 1024.0) << " MB indices" << std::endl;
+  }
+
+  GeometryAllocation::GeometryAllocation():
+    handle(INVALID_GEOMETRY)
+  {
+  }
+
+  GeometryAllocation::GeometryAllocation(GeometryHandle handle):
+    handle(handle)
+  {
+  }
+
+  GeometryAllocation::~GeometryAllocation()
+  {
+    if (this->handle != INVALID_GEOMETRY) GeometryHeap::shared().free(this->handle);
+  }
+
+  GeometryAllocation::GeometryAllocation(GeometryAllocation&& other) noexcept:
+    handle(other.handle)
+  {
+    other.handle = INVALID_GEOMETRY;
+  }
+
+  GeometryAllocation& GeometryAllocation::operator=(GeometryAllocation&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (this->handle != INVALID_GEOMETRY) GeometryHeap::shared().free(this->handle);
+      this->handle = other.handle;
+      other.handle = INVALID_GEOMETRY;
+    }
+
+    return *this;
+  }
+
+  GeometryHandle GeometryAllocation::get() const
+  {
+    return this->handle;
+  }
+
+  bool GeometryAllocation::isValid() const
+  {
+    return this->handle != INVALID_GEOMETRY;
+  }
+}
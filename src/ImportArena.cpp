@@ -0,0 +1,53 @@
+#include "ImportArena.h"
+
+#include <cstdint>
+
+ImportArena::ImportArena(size_t blockSize):
+  cursor(nullptr),
+  limit(nullptr),
+  blockSize(blockSize),
+  stats{ 0, 0, 0, 0 }
+{
+}
+
+void* ImportArena::allocate(size_t size, size_t alignment)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->stats.allocations++;
+  this->stats.bytesAllocated += size;
+
+  uintptr_t aligned = (reinterpret_cast<uintptr_t>(this->cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+  if (this->cursor && aligned + size <= reinterpret_cast<uintptr_t>(this->limit))
+  {
+    this->cursor = reinterpret_cast<unsigned char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  // Oversized requests get a block of their own so the current block keeps serving small ones.
+  size_t capacity = size + alignment;
+  bool dedicated = capacity > this->blockSize / 4;
+  if (!dedicated) capacity = this->blockSize;
+
+  Block block = { std::unique_ptr<unsigned char[]>(new unsigned char[capacity]), capacity };
+  unsigned char* memory = block.memory.get();
+  this->blocks.push_back(std::move(block));
+  this->stats.bytesReserved += capacity;
+  this->stats.blocks++;
+
+  aligned = (reinterpret_cast<uintptr_t>(memory) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+  if (!dedicated)
+  {
+    this->cursor = reinterpret_cast<unsigned char*>(aligned + size);
+    this->limit = memory + capacity;
+  }
+
+  return reinterpret_cast<void*>(aligned);
+}
+
+ImportArenaStats ImportArena::getStats() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  return this->stats;
+}
@@ -0,0 +1,119 @@
+#include "InitGraph.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "StartupProfiler.h"
+#include "ThreadPool.h"
+
+unsigned int InitGraph::add(const std::string& name, InitThread thread, Task task, std::vector<unsigned int> dependencies)
+{
+  unsigned int index = static_cast<unsigned int>(this->nodes.size());
+  this->nodes.push_back({ name, thread, std::move(task), {}, static_cast<unsigned int>(dependencies.size()), 0 });
+
+  for (unsigned int dependency : dependencies)
+  {
+    this->nodes[dependency].dependents.push_back(index);
+  }
+
+  return index;
+}
+
+bool InitGraph::execute(unsigned int index)
+{
+  StartupPhase phase(this->nodes[index].name);
+
+  return this->nodes[index].task();
+}
+
+void InitGraph::schedule(unsigned int index)
+{
+  // Called with the mutex held.
+  if (this->nodes[index].thread == InitThread::Main)
+  {
+    this->mainReady.push_back(index);
+    return;
+  }
+
+  this->runningWorkers++;
+  ThreadPool::shared().submit([this, index]()
+  {
+    bool success = this->execute(index);
+    this->finish(index, success);
+  });
+}
+
+void InitGraph::finish(unsigned int index, bool success)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (this->nodes[index].thread == InitThread::Worker) this->runningWorkers--;
+  this->completed++;
+
+  if (!success)
+  {
+    std::cerr << "Error: Startup step \"" << this->nodes[index].name << "\" failed" << std::endl;
+    this->failed = true;
+  }
+
+  if (!this->failed)
+  {
+    for (unsigned int dependent : this->nodes[index].dependents)
+    {
+      if (--this->nodes[dependent].remaining == 0) this->schedule(dependent);
+    }
+  }
+
+  this->changed.notify_all();
+}
+
+bool InitGraph::run()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  this->mainReady.clear();
+  this->runningWorkers = 0;
+  this->completed = 0;
+  this->failed = false;
+
+  for (Node& node : this->nodes)
+  {
+    node.remaining = node.dependencyCount;
+  }
+
+  for (unsigned int i = 0; i < this->nodes.size(); i++)
+  {
+    if (this->nodes[i].remaining == 0) this->schedule(i);
+  }
+
+  while (!this->failed && this->completed < this->nodes.size())
+  {
+    if (this->mainReady.empty())
+    {
+      if (this->runningWorkers == 0)
+      {
+        std::cerr << "Error: Startup graph has a dependency cycle" << std::endl;
+        this->failed = true;
+        break;
+      }
+
+      this->changed.wait(lock);
+      continue;
+    }
+
+    // Main steps run in the order they were added, which keeps GL setup deterministic.
+    auto next = std::min_element(this->mainReady.begin(), this->mainReady.end());
+    unsigned int index = *next;
+    this->mainReady.erase(next);
+
+    lock.unlock();
+    bool success = this->execute(index);
+    this->finish(index, success);
+    lock.lock();
+  }
+
+  // Worker steps capture this graph, so they have to drain before it can go away.
+  this->changed.wait(lock, [this]() { return this->runningWorkers == 0; });
+
+  return !this->failed;
+}
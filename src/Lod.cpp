@@ -0,0 +1,353 @@
+#include "Lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "Hash.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+namespace Model
+{
+  struct Quadric
+  {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    void addPlane(const glm::dvec3& normal, double distance, double area)
+    {
+      this->addPlane(normal * std::sqrt(area), distance * std::sqrt(area));
+      this->weight += area;
+    }
+
+    void addPlane(const glm::dvec3& normal, double distance)
+    {
+      this->a00 += normal.x * normal.x;
+      this->a01 += normal.x * normal.y;
+      this->a02 += normal.x * normal.z;
+      this->a03 += normal.x * distance;
+      this->a11 += normal.y * normal.y;
+      this->a12 += normal.y * normal.z;
+      this->a13 += normal.y * distance;
+      this->a22 += normal.z * normal.z;
+      this->a23 += normal.z * distance;
+      this->a33 += distance * distance;
+    }
+
+    void add(const Quadric& other)
+    {
+      this->a00 += other.a00; this->a01 += other.a01; this->a02 += other.a02; this->a03 += other.a03;
+      this->a11 += other.a11; this->a12 += other.a12; this->a13 += other.a13;
+      this->a22 += other.a22; this->a23 += other.a23;
+      this->a33 += other.a33;
+      this->weight += other.weight;
+    }
+
+    // Area-weighted mean squared distance from p to the accumulated planes.
+    double evaluate(const glm::vec3& p) const
+    {
+      double x = p.x, y = p.y, z = p.z;
+
+      double sum = this->a00 * x * x + 2 * this->a01 * x * y + 2 * this->a02 * x * z + 2 * this->a03 * x
+        + this->a11 * y * y + 2 * this->a12 * y * z + 2 * this->a13 * y
+        + this->a22 * z * z + 2 * this->a23 * z
+        + this->a33;
+
+      return this->weight > 0.0 ? sum / this->weight : 0.0;
+    }
+  };
+
+  struct Collapse
+  {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+  };
+
+  // State shared by all levels of one chain, so errors accumulate against the original surface.
+  class Simplifier
+  {
+  public:
+    Simplifier(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+    std::vector<unsigned int> simplify(const std::vector<unsigned int>& input, size_t targetIndexCount);
+    float getError() const;
+
+  private:
+    const std::vector<Vertex>& vertices;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> locked;
+    double maxCost;
+
+    bool flipsTriangle(const Collapse& collapse, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& adjacency) const;
+  };
+
+  static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+  {
+    return glm::cross(b - a, c - a);
+  }
+
+  Simplifier::Simplifier(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices):
+    vertices(vertices),
+    quadrics(vertices.size()),
+    locked(vertices.size(), false),
+    maxCost(0.0)
+  {
+    // Vertices sharing a position with another vertex sit on an attribute seam.
+    std::unordered_map<uint64_t, unsigned int> firstAtPosition;
+    std::vector<unsigned int> positionId(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+      auto inserted = firstAtPosition.emplace(hashBytes(&vertices[i].position, sizeof(glm::vec3)), static_cast<unsigned int>(i));
+      positionId[i] = inserted.first->second;
+
+      if (!inserted.second)
+      {
+        this->locked[i] = true;
+        this->locked[inserted.first->second] = true;
+      }
+    }
+
+    // Edges used by exactly one triangle (in position space) are open borders.
+    std::unordered_map<uint64_t, int> edgeUse;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      const glm::vec3& a = vertices[indices[i]].position;
+      const glm::vec3& b = vertices[indices[i + 1]].position;
+      const glm::vec3& c = vertices[indices[i + 2]].position;
+
+      glm::dvec3 normal = glm::dvec3(triangleNormal(a, b, c));
+      double length = glm::length(normal);
+
+      if (length > 0.0)
+      {
+        normal /= length;
+        double distance = -glm::dot(normal, glm::dvec3(a));
+
+        for (size_t j = 0; j < 3; j++) this->quadrics[indices[i + j]].addPlane(normal, distance, length * 0.5);
+      }
+
+      for (size_t j = 0; j < 3; j++)
+      {
+        uint64_t p = positionId[indices[i + j]];
+        uint64_t q = positionId[indices[i + (j + 1) % 3]];
+        edgeUse[std::min(p, q) << 32 | std::max(p, q)]++;
+      }
+    }
+
+    for (const auto& edge : edgeUse)
+    {
+      if (edge.second != 1) continue;
+
+      unsigned int p = static_cast<unsigned int>(edge.first >> 32);
+      unsigned int q = static_cast<unsigned int>(edge.first & 0xFFFFFFFFu);
+      this->locked[p] = true;
+      this->locked[q] = true;
+    }
+  }
+
+  bool Simplifier::flipsTriangle(const Collapse& collapse, const std::vector<unsigned int>& indices, const std::vector<unsigned int>& offsets, const std::vector<unsigned int>& adjacency) const
+  {
+    const glm::vec3& target = this->vertices[collapse.to].position;
+
+    for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+    {
+      const unsigned int* triangle = &indices[adjacency[a] * 3];
+      if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) continue;
+
+      glm::vec3 before[3];
+      glm::vec3 after[3];
+      for (int j = 0; j < 3; j++)
+      {
+        before[j] = this->vertices[triangle[j]].position;
+        after[j] = triangle[j] == collapse.from ? target : before[j];
+      }
+
+      glm::vec3 oldNormal = triangleNormal(before[0], before[1], before[2]);
+      glm::vec3 newNormal = triangleNormal(after[0], after[1], after[2]);
+
+      if (glm::dot(oldNormal, newNormal) <= 0.0f) return true;
+    }
+
+    return false;
+  }
+
+  std::vector<unsigned int> Simplifier::simplify(const std::vector<unsigned int>& input, size_t targetIndexCount)
+  {
+    std::vector<unsigned int> indices = input;
+    size_t vertexCount = this->vertices.size();
+
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> offsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    while (indices.size() > targetIndexCount)
+    {
+      collapses.clear();
+
+      for (size_t i = 0; i < indices.size(); i += 3)
+      {
+        for (size_t j = 0; j < 3; j++)
+        {
+          unsigned int p = indices[i + j];
+          unsigned int q = indices[i + (j + 1) % 3];
+
+          if (!this->locked[p] && glm::dot(this->vertices[p].normal, this->vertices[q].normal) >= LOD_NORMAL_THRESHOLD)
+          {
+            collapses.push_back({ p, q, this->quadrics[p].evaluate(this->vertices[q].position) });
+          }
+
+          if (!this->locked[q] && glm::dot(this->vertices[p].normal, this->vertices[q].normal) >= LOD_NORMAL_THRESHOLD)
+          {
+            collapses.push_back({ q, p, this->quadrics[q].evaluate(this->vertices[p].position) });
+          }
+        }
+      }
+
+      if (collapses.empty()) break;
+
+      std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+      std::fill(offsets.begin(), offsets.end(), 0);
+      for (unsigned int index : indices) offsets[index + 1]++;
+      for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+      adjacency.resize(indices.size());
+      std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+      for (size_t v = 0; v < vertexCount; v++) remap[v] = static_cast<unsigned int>(v);
+      std::fill(touched.begin(), touched.end(), false);
+
+      // Greedy pass: take the cheapest collapses whose neighbourhoods do not overlap.
+      size_t remaining = indices.size();
+      size_t applied = 0;
+
+      for (const Collapse& collapse : collapses)
+      {
+        if (remaining <= targetIndexCount) break;
+        if (touched[collapse.from] || touched[collapse.to]) continue;
+        if (this->flipsTriangle(collapse, indices, offsets, adjacency)) continue;
+
+        for (unsigned int a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+        {
+          const unsigned int* triangle = &indices[adjacency[a] * 3];
+          bool degenerate = false;
+
+          for (int j = 0; j < 3; j++)
+          {
+            touched[triangle[j]] = true;
+            degenerate |= triangle[j] == collapse.to;
+          }
+
+          if (degenerate) remaining -= 3;
+        }
+
+        remap[collapse.from] = collapse.to;
+        this->quadrics[collapse.to].add(this->quadrics[collapse.from]);
+        this->maxCost = std::max(this->maxCost, collapse.cost);
+        applied++;
+      }
+
+      if (applied == 0) break;
+
+      size_t write = 0;
+      for (size_t i = 0; i < indices.size(); i += 3)
+      {
+        unsigned int a = remap[indices[i]];
+        unsigned int b = remap[indices[i + 1]];
+        unsigned int c = remap[indices[i + 2]];
+
+        if (a == b || b == c || a == c) continue;
+
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+      }
+
+      indices.resize(write);
+    }
+
+    return indices;
+  }
+
+  float Simplifier::getError() const
+  {
+    return static_cast<float>(std::sqrt(std::max(this->maxCost, 0.0)));
+  }
+
+  LodChain generateLods(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, unsigned int levelCount)
+  {
+    LodChain chain;
+    if (indices.size() < 3 || vertices.empty()) return chain;
+
+    glm::vec3 minimum = vertices[indices[0]].position;
+    glm::vec3 maximum = minimum;
+    for (unsigned int index : indices)
+    {
+      minimum = glm::min(minimum, vertices[index].position);
+      maximum = glm::max(maximum, vertices[index].position);
+    }
+
+    chain.center = (minimum + maximum) * 0.5f;
+    for (unsigned int index : indices)
+    {
+      chain.radius = std::max(chain.radius, glm::length(vertices[index].position - chain.center));
+    }
+
+    chain.levels.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    Simplifier simplifier(indices, vertices);
+    std::vector<unsigned int> previous = indices;
+
+    for (unsigned int level = 1; level <= levelCount && level < MAX_LOD_LEVELS; level++)
+    {
+      size_t target = static_cast<size_t>(previous.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+      std::vector<unsigned int> simplified = simplifier.simplify(previous, target);
+
+      if (simplified.empty() || simplified.size() > previous.size() * LOD_MIN_REDUCTION) break;
+
+      previous = simplified;
+      optimizeVertexCache(simplified, vertices.size());
+
+      chain.levels.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), simplifier.getError() });
+      indices.insert(indices.end(), simplified.begin(), simplified.end());
+    }
+
+    return chain;
+  }
+
+  LodSelector::LodSelector(const Camera& camera, float viewportHeight, const glm::mat4& model)
+  {
+    glm::mat4 inverseModel = glm::inverse(model);
+    this->cameraPosition = glm::vec3(inverseModel * glm::vec4(camera.position, 1.0f));
+
+    // Distances are measured in object space, so the world-space projection scale is unaffected by the model scale.
+    this->pixelsPerUnit = viewportHeight / (2.0f * std::tan(glm::radians(camera.fov) * 0.5f));
+  }
+
+  unsigned int LodSelector::select(const LodChain& chain) const
+  {
+    if (chain.levels.size() <= 1) return 0;
+
+    float distance = glm::length(chain.center - this->cameraPosition) - chain.radius;
+    if (distance <= 0.0f) return 0;
+
+    unsigned int selected = 0;
+    for (unsigned int level = 1; level < chain.levels.size(); level++)
+    {
+      if (chain.levels[level].error / distance * this->pixelsPerUnit > LOD_PIXEL_ERROR) break;
+      selected = level;
+    }
+
+    return selected;
+  }
+}
@@ -0,0 +1,88 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utility>
+
+MappedFile::MappedFile():
+  mapping(nullptr),
+  length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  this->close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept:
+  mapping(std::exchange(other.mapping, nullptr)),
+  length(std::exchange(other.length, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    this->close();
+    this->mapping = std::exchange(other.mapping, nullptr);
+    this->length = std::exchange(other.length, 0);
+  }
+
+  return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+  this->close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (address == MAP_FAILED) return false;
+
+  this->mapping = address;
+  this->length = static_cast<size_t>(info.st_size);
+
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (this->mapping)
+  {
+    munmap(this->mapping, this->length);
+  }
+
+  this->mapping = nullptr;
+  this->length = 0;
+}
+
+bool MappedFile::isOpen() const
+{
+  return this->mapping != nullptr;
+}
+
+const unsigned char* MappedFile::data() const
+{
+  return static_cast<const unsigned char*>(this->mapping);
+}
+
+size_t MappedFile::size() const
+{
+  return this->length;
+}
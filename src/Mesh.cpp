@@ -1,74 +1,398 @@
 #include "Mesh.h"
 
+#include "VertexQuantizer.h"
+
 namespace Model
 {
-  Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+  size_t indexSize(GLenum indexType)
+  {
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+  }
+
+  Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures):
+    vertexFormat(VertexFormat::Float)
   {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    this->vertices = std::move(vertices);
+    this->textures = std::move(textures);
+    this->storeIndices(std::move(indices), this->vertices.size());
 
-    this->setupMesh();
+    this->setupMesh(this->vertices.data(), this->vertices.size(), this->getIndexData(), this->getIndexCount());
   }
 
-  void Mesh::setupMesh()
+  Mesh::Mesh(std::vector<PackedVertex> vertices, const VertexQuantization& quantization, std::vector<unsigned int> indices, std::vector<Texture> textures):
+    vertexFormat(VertexFormat::Packed),
+    quantization(quantization)
   {
-    glGenVertexArrays(1, &this->VAO);
-    glGenBuffers(1, &this->VBO);
-    glGenBuffers(1, &this->EBO);
+    this->packedVertices = std::move(vertices);
+    this->textures = std::move(textures);
+    this->storeIndices(std::move(indices), this->packedVertices.size());
 
-    glBindVertexArray(this->VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
+    this->setupMesh(this->packedVertices.data(), this->packedVertices.size(), this->getIndexData(), this->getIndexCount());
+  }
 
-    glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), &this->vertices[0], GL_STATIC_DRAW);
+  Mesh::Mesh(const Vertex* vertices, size_t numVertices, const void* indices, GLenum indexType, size_t numIndices, std::vector<Texture> textures):
+    indexType(indexType),
+    vertexFormat(VertexFormat::Float)
+  {
+    this->textures = std::move(textures);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int),
-      &this->indices[0], GL_STATIC_DRAW);
+    this->setupMesh(vertices, numVertices, indices, numIndices);
+  }
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+  Mesh::Mesh(const PackedVertex* vertices, size_t numVertices, const VertexQuantization& quantization, const void* indices, GLenum indexType, size_t numIndices, std::vector<Texture> textures):
+    indexType(indexType),
+    vertexFormat(VertexFormat::Packed),
+    quantization(quantization)
+  {
+    this->textures = std::move(textures);
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    this->setupMesh(vertices, numVertices, indices, numIndices);
+  }
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+  void Mesh::storeIndices(std::vector<unsigned int> indices, size_t numVertices)
+  {
+    if (numVertices <= SHORT_INDEX_VERTEX_LIMIT)
+    {
+      this->indexType = GL_UNSIGNED_SHORT;
+      this->shortIndices.assign(indices.begin(), indices.end());
+    }
+    else
+    {
+      this->indexType = GL_UNSIGNED_INT;
+      this->indices = std::move(indices);
+    }
+  }
 
-    glBindVertexArray(0);
+  VertexFormat Mesh::getVertexFormat() const
+  {
+    return this->vertexFormat;
   }
 
-  void Mesh::draw(Shader& shader)
+  const VertexQuantization& Mesh::getQuantization() const
   {
-    unsigned int numDiffuse = 1;
-    unsigned int numSpecular = 1;
+    return this->quantization;
+  }
 
-    for (unsigned int i = 0; i < this->textures.size(); i++)
+  GLenum Mesh::getIndexType() const
+  {
+    return this->indexType;
+  }
+
+  const void* Mesh::getIndexData() const
+  {
+    if (this->mapping) return this->mappedIndices;
+
+    return this->indexType == GL_UNSIGNED_SHORT ? static_cast<const void*>(this->shortIndices.data()) : static_cast<const void*>(this->indices.data());
+  }
+
+  size_t Mesh::getIndexCount() const
+  {
+    if (this->mapping) return this->mappedIndexCount;
+
+    return this->indexType == GL_UNSIGNED_SHORT ? this->shortIndices.size() : this->indices.size();
+  }
+
+  template <typename T>
+  static void releaseVector(std::vector<T>& vector)
+  {
+    std::vector<T>().swap(vector);
+  }
+
+  template <typename T>
+  static size_t vectorBytes(const std::vector<T>& vector)
+  {
+    return vector.capacity() * sizeof(T);
+  }
+
+  void Mesh::setMappedGeometry(std::shared_ptr<const void> mapping, const void* vertices, size_t numVertices, const void* indices, size_t numIndices)
+  {
+    releaseVector(this->vertices);
+    releaseVector(this->packedVertices);
+    releaseVector(this->indices);
+    releaseVector(this->shortIndices);
+
+    this->mapping = std::move(mapping);
+    this->mappedVertices = vertices;
+    this->mappedVertexCount = numVertices;
+    this->mappedIndices = indices;
+    this->mappedIndexCount = numIndices;
+  }
+
+  bool Mesh::hasMappedGeometry() const
+  {
+    return this->mapping != nullptr;
+  }
+
+  void Mesh::loadCpuGeometry()
+  {
+    if (!this->mapping) return;
+
+    if (this->vertexFormat == VertexFormat::Packed)
     {
-      glActiveTexture(GL_TEXTURE0 + i);
+      const PackedVertex* vertices = static_cast<const PackedVertex*>(this->mappedVertices);
+      this->packedVertices.assign(vertices, vertices + this->mappedVertexCount);
+    }
+    else
+    {
+      const Vertex* vertices = static_cast<const Vertex*>(this->mappedVertices);
+      this->vertices.assign(vertices, vertices + this->mappedVertexCount);
+    }
+
+    if (this->indexType == GL_UNSIGNED_SHORT)
+    {
+      const uint16_t* indices = static_cast<const uint16_t*>(this->mappedIndices);
+      this->shortIndices.assign(indices, indices + this->mappedIndexCount);
+    }
+    else
+    {
+      const unsigned int* indices = static_cast<const unsigned int*>(this->mappedIndices);
+      this->indices.assign(indices, indices + this->mappedIndexCount);
+    }
+
+    this->mapping.reset();
+    this->mappedVertices = nullptr;
+    this->mappedVertexCount = 0;
+    this->mappedIndices = nullptr;
+    this->mappedIndexCount = 0;
+  }
+
+  void Mesh::applyResidency(GeometryResidency residency)
+  {
+    if (residency == GeometryResidency::Keep) return;
+
+    // Positions are decoded from owned arrays; Discard just lets go of the mapping.
+    if (residency == GeometryResidency::Positions)
+    {
+      this->loadCpuGeometry();
+    }
+    else
+    {
+      this->setMappedGeometry(nullptr, nullptr, 0, nullptr, 0);
+    }
 
-      std::stringstream ss;
-      std::string name = this->textures[i].type;
+    if (residency == GeometryResidency::Positions)
+    {
+      size_t vertexCount = this->vertexFormat == VertexFormat::Packed ? this->packedVertices.size() : this->vertices.size();
+      this->positions.resize(vertexCount);
 
-      if ("texture_diffuse" == name)
+      for (size_t i = 0; i < vertexCount; i++)
       {
-        ss << numDiffuse++;
+        this->positions[i] = this->vertexFormat == VertexFormat::Packed ? unpackVertex(this->packedVertices[i], this->quantization).position : this->vertices[i].position;
       }
-      else if ("texture_specular" == name)
+
+      // Generated levels are appended after the full mesh, so picking only needs the front of the array.
+      size_t fullDetail = this->lods.levels.empty() ? this->getIndexCount() : this->lods.levels[0].indexCount;
+      if (this->shortIndices.size() > fullDetail) this->shortIndices.resize(fullDetail);
+      if (this->indices.size() > fullDetail) this->indices.resize(fullDetail);
+      this->shortIndices.shrink_to_fit();
+      this->indices.shrink_to_fit();
+    }
+    else
+    {
+      releaseVector(this->indices);
+      releaseVector(this->shortIndices);
+    }
+
+    releaseVector(this->vertices);
+    releaseVector(this->packedVertices);
+  }
+
+  GeometryMemory Mesh::getMemory() const
+  {
+    GeometryMemory memory;
+    memory.cpuBytes = sizeof(Mesh) + vectorBytes(this->vertices) + vectorBytes(this->packedVertices) + vectorBytes(this->indices) +
+      vectorBytes(this->shortIndices) + vectorBytes(this->positions) + vectorBytes(this->textures) + vectorBytes(this->meshlets) +
+      vectorBytes(this->lods.levels);
+
+    // Mapped cache pages are counted too: the mesh keeps them addressable as its CPU copy.
+    size_t stride = this->vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    if (this->mapping) memory.cpuBytes += this->mappedVertexCount * stride + this->mappedIndexCount * indexSize(this->indexType);
+
+    const GeometryRange& range = GeometryHeap::shared().getRange(this->geometry.get());
+    memory.gpuBytes = static_cast<size_t>(range.vertexCount) * stride + static_cast<size_t>(range.indexBytes);
+
+    return memory;
+  }
+
+  void Mesh::setupMesh(const void* vertices, size_t numVertices, const void* indices, size_t numIndices)
+  {
+    this->indexCount = static_cast<unsigned int>(numIndices);
+    this->geometry = GeometryAllocation(GeometryHeap::shared().allocate(this->vertexFormat, vertices, numVertices, indices, numIndices * indexSize(this->indexType)));
+  }
+
+  void Mesh::drawInstanced(Shader& shader, GLuint instanceBuffer, GLintptr instanceOffset, GLsizei instanceCount)
+  {
+    this->bindMaterial(shader);
+
+    // indexCount also spans the generated levels, so only the full-detail range is drawn.
+    unsigned int firstIndex, count;
+    this->getLevelRange(0, firstIndex, count);
+
+    GeometryHeap& heap = GeometryHeap::shared();
+    const GeometryRange& range = heap.getRange(this->geometry.get());
+    uintptr_t offset = range.indexOffset + static_cast<uintptr_t>(firstIndex) * indexSize(this->indexType);
+
+    heap.bindInstanced(this->vertexFormat, instanceBuffer, instanceOffset);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, count, this->indexType, reinterpret_cast<const void*>(offset), instanceCount, range.baseVertex);
+  }
+
+  void Mesh::getLevelRange(unsigned int level, unsigned int& firstIndex, unsigned int& count) const
+  {
+    // Generated levels live after the full mesh in the same index buffer.
+    firstIndex = 0;
+    count = this->indexCount;
+
+    if (level < this->lods.levels.size())
+    {
+      firstIndex = this->lods.levels[level].firstIndex;
+      count = this->lods.levels[level].indexCount;
+    }
+  }
+
+  unsigned int Mesh::appendDrawRanges(unsigned int level, const MeshletCullContext* cull, MeshletCullStats* stats, std::vector<GLsizei>& counts, std::vector<const void*>& offsets) const
+  {
+    const GeometryRange& range = GeometryHeap::shared().getRange(this->geometry.get());
+    size_t stride = indexSize(this->indexType);
+
+    if (level > 0 || !cull || this->meshlets.empty())
+    {
+      unsigned int firstIndex, count;
+      this->getLevelRange(level, firstIndex, count);
+
+      counts.push_back(static_cast<GLsizei>(count));
+      offsets.push_back(reinterpret_cast<const void*>(range.indexOffset + static_cast<uintptr_t>(firstIndex) * stride));
+
+      return 1;
+    }
+
+    size_t firstRange = counts.size();
+    uint32_t rangeEnd = ~0u;
+
+    for (const Meshlet& meshlet : this->meshlets)
+    {
+      if (stats) stats->total++;
+      if (!isMeshletVisible(meshlet, *cull)) continue;
+
+      if (stats) stats->visible++;
+
+      if (meshlet.firstIndex == rangeEnd)
+      {
+        counts.back() += static_cast<GLsizei>(meshlet.indexCount);
+      }
+      else
       {
-        ss << numSpecular++;
+        counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+        offsets.push_back(reinterpret_cast<const void*>(range.indexOffset + static_cast<uintptr_t>(meshlet.firstIndex) * stride));
       }
 
-      std::string number = ss.str();
+      rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+    }
+
+    unsigned int added = static_cast<unsigned int>(counts.size() - firstRange);
+    if (stats) stats->drawRanges += added;
+
+    return added;
+  }
+
+  GeometryHandle Mesh::getGeometry() const
+  {
+    return this->geometry.get();
+  }
+
+  const glm::vec3& Mesh::getCenter() const
+  {
+    return this->center;
+  }
+
+  void Mesh::setMeshlets(std::vector<Meshlet> meshlets)
+  {
+    this->meshlets = std::move(meshlets);
+
+    if (this->lods.levels.empty() && !this->meshlets.empty())
+    {
+      glm::vec3 sum(0.0f);
+      for (const Meshlet& meshlet : this->meshlets) sum += meshlet.center;
+      this->center = sum / static_cast<float>(this->meshlets.size());
+    }
+  }
+
+  const std::vector<Meshlet>& Mesh::getMeshlets() const
+  {
+    return this->meshlets;
+  }
+
+  void Mesh::setLods(LodChain lods)
+  {
+    this->lods = std::move(lods);
+
+    if (!this->lods.levels.empty()) this->center = this->lods.center;
+  }
+
+  const LodChain& Mesh::getLods() const
+  {
+    return this->lods;
+  }
+
+  void Mesh::bindMaterial(Shader& shader) const
+  {
+    this->bindTextures(shader);
+    this->bindQuantization(shader);
+  }
+
+  void Mesh::bindTextures(Shader& shader) const
+  {
+    const MaterialUniforms& uniforms = this->resolveUniforms(shader);
 
-      shader.setInt(("material." + name + number).c_str(), i);
+    for (unsigned int i = 0; i < this->textures.size(); i++)
+    {
+      glActiveTexture(GL_TEXTURE0 + i);
+      shader.setInt(uniforms.samplers[i], i);
       glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
 
     glActiveTexture(GL_TEXTURE0);
+  }
+
+  void Mesh::bindQuantization(Shader& shader) const
+  {
+    const MaterialUniforms& uniforms = this->resolveUniforms(shader);
+
+    shader.setVec3(uniforms.positionOffset, this->quantization.offset);
+    shader.setVec3(uniforms.positionScale, this->quantization.scale);
+  }
+
+  const Mesh::MaterialUniforms& Mesh::resolveUniforms(const Shader& shader) const
+  {
+    MaterialUniforms& uniforms = this->materialUniforms;
+    if (uniforms.program == shader.id && uniforms.samplers.size() == this->textures.size()) return uniforms;
+
+    // Names are only built when the mesh meets a new program, not every frame.
+    unsigned int numDiffuse = 1;
+    unsigned int numSpecular = 1;
+
+    uniforms.program = shader.id;
+    uniforms.samplers.clear();
+    uniforms.samplers.reserve(this->textures.size());
+
+    for (const Texture& texture : this->textures)
+    {
+      std::string number;
+
+      if ("texture_diffuse" == texture.type)
+      {
+        number = std::to_string(numDiffuse++);
+      }
+      else if ("texture_specular" == texture.type)
+      {
+        number = std::to_string(numSpecular++);
+      }
+
+      uniforms.samplers.push_back(shader.getUniform("material." + texture.type + number));
+    }
+
+    uniforms.positionOffset = shader.getUniform("positionOffset");
+    uniforms.positionScale = shader.getUniform("positionScale");
 
-    glBindVertexArray(this->VAO);
-    glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    return uniforms;
   }
 }
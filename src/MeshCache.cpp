@@ -0,0 +1,291 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Hash.h"
+#include "ObjLoader.h"
+
+namespace Model
+{
+  constexpr uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+  static uint64_t alignOffset(uint64_t offset)
+  {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+  }
+
+  static void writePadding(std::ofstream& out, uint64_t& offset)
+  {
+    static const char zeros[MESH_CACHE_ALIGNMENT] = {};
+
+    uint64_t aligned = alignOffset(offset);
+    out.write(zeros, static_cast<std::streamsize>(aligned - offset));
+    offset = aligned;
+  }
+
+  static size_t vertexCount(const Mesh& mesh)
+  {
+    return mesh.getVertexFormat() == VertexFormat::Packed ? mesh.packedVertices.size() : mesh.vertices.size();
+  }
+
+  static uint64_t vertexBytes(const Mesh& mesh)
+  {
+    return mesh.getVertexFormat() == VertexFormat::Packed ? mesh.packedVertices.size() * sizeof(PackedVertex) : mesh.vertices.size() * sizeof(Vertex);
+  }
+
+  std::string MeshCache::cachePath(const std::string& sourcePath)
+  {
+    return sourcePath + MESH_CACHE_EXTENSION;
+  }
+
+  bool MeshCache::fingerprint(const std::string& sourcePath, SourceFingerprint& fingerprint)
+  {
+    AssetFile source;
+    if (!source.open(sourcePath)) return false;
+
+    fingerprint.size = source.size();
+    fingerprint.hash = hashBytes(source.data(), source.size());
+    fingerprint.processing = 0;
+
+    std::string extension = sourcePath.substr(sourcePath.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != "obj") return true;
+
+    // Materials (and with them the texture list of every mesh) live in the .mtl files, so an edit
+    // there must invalidate the cache as well. A missing library still contributes its path.
+    for (const std::string& libraryPath : findMaterialLibraries(sourcePath, source.data(), source.size()))
+    {
+      fingerprint.hash = hashBytes(libraryPath.data(), libraryPath.size(), fingerprint.hash);
+
+      AssetFile library;
+      if (!library.open(libraryPath)) continue;
+
+      fingerprint.size += library.size();
+      fingerprint.hash = hashBytes(library.data(), library.size(), fingerprint.hash);
+    }
+
+    return true;
+  }
+
+  bool MeshCache::write(const std::string& sourcePath, const SourceFingerprint& fingerprint, const std::vector<Mesh>& meshes)
+  {
+    std::vector<MeshCacheEntry> entries(meshes.size());
+
+    // Lay out the header, entry table and texture references first, then the aligned geometry blobs.
+    uint64_t offset = sizeof(MeshCacheHeader) + entries.size() * sizeof(MeshCacheEntry);
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+      entries[i].textureOffset = offset;
+      entries[i].textureCount = static_cast<uint32_t>(meshes[i].textures.size());
+      entries[i].vertexFormat = static_cast<uint32_t>(meshes[i].getVertexFormat());
+
+      const VertexQuantization& quantization = meshes[i].getQuantization();
+      for (int axis = 0; axis < 3; axis++)
+      {
+        entries[i].positionOffset[axis] = quantization.offset[axis];
+        entries[i].positionScale[axis] = quantization.scale[axis];
+      }
+
+      for (const Texture& texture : meshes[i].textures)
+      {
+        offset += 2 * sizeof(uint32_t) + texture.type.size() + texture.path.length;
+      }
+    }
+
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+      offset = alignOffset(offset);
+      entries[i].vertexOffset = offset;
+      entries[i].vertexCount = static_cast<uint32_t>(vertexCount(meshes[i]));
+      offset += vertexBytes(meshes[i]);
+
+      offset = alignOffset(offset);
+      entries[i].indexOffset = offset;
+      entries[i].indexCount = static_cast<uint32_t>(meshes[i].getIndexCount());
+      entries[i].indexType = meshes[i].getIndexType();
+      offset += meshes[i].getIndexCount() * indexSize(meshes[i].getIndexType());
+
+      offset = alignOffset(offset);
+      entries[i].meshletOffset = offset;
+      entries[i].meshletCount = static_cast<uint32_t>(meshes[i].getMeshlets().size());
+      offset += meshes[i].getMeshlets().size() * sizeof(Meshlet);
+
+      const LodChain& lods = meshes[i].getLods();
+      offset = alignOffset(offset);
+      entries[i].lodOffset = offset;
+      entries[i].lodCount = static_cast<uint32_t>(lods.levels.size());
+      entries[i].lodRadius = lods.radius;
+      entries[i].reserved = 0;
+      for (int axis = 0; axis < 3; axis++) entries[i].lodCenter[axis] = lods.center[axis];
+      offset += lods.levels.size() * sizeof(LodLevel);
+    }
+
+    // Write to a temporary file and rename it into place so a partial write is never picked up.
+    std::string path = cachePath(sourcePath);
+    std::string tempPath = path + ".tmp";
+
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      std::cerr << "Error: Unable to write mesh cache " << tempPath << std::endl;
+      return false;
+    }
+
+    MeshCacheHeader header;
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.sourceSize = fingerprint.size;
+    header.sourceHash = fingerprint.hash;
+    header.processingHash = fingerprint.processing;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(MeshCacheEntry)));
+
+    for (const Mesh& mesh : meshes)
+    {
+      for (const Texture& texture : mesh.textures)
+      {
+        uint32_t lengths[2] = { static_cast<uint32_t>(texture.type.size()), static_cast<uint32_t>(texture.path.length) };
+        out.write(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+        out.write(texture.type.data(), lengths[0]);
+        out.write(texture.path.data, lengths[1]);
+      }
+    }
+
+    offset = static_cast<uint64_t>(out.tellp());
+
+    for (const Mesh& mesh : meshes)
+    {
+      const void* vertices = mesh.getVertexFormat() == VertexFormat::Packed ? static_cast<const void*>(mesh.packedVertices.data()) : static_cast<const void*>(mesh.vertices.data());
+
+      writePadding(out, offset);
+      out.write(static_cast<const char*>(vertices), static_cast<std::streamsize>(vertexBytes(mesh)));
+      offset += vertexBytes(mesh);
+
+      writePadding(out, offset);
+      size_t indexBytes = mesh.getIndexCount() * indexSize(mesh.getIndexType());
+      out.write(static_cast<const char*>(mesh.getIndexData()), static_cast<std::streamsize>(indexBytes));
+      offset += indexBytes;
+
+      writePadding(out, offset);
+      out.write(reinterpret_cast<const char*>(mesh.getMeshlets().data()), static_cast<std::streamsize>(mesh.getMeshlets().size() * sizeof(Meshlet)));
+      offset += mesh.getMeshlets().size() * sizeof(Meshlet);
+
+      writePadding(out, offset);
+      out.write(reinterpret_cast<const char*>(mesh.getLods().levels.data()), static_cast<std::streamsize>(mesh.getLods().levels.size() * sizeof(LodLevel)));
+      offset += mesh.getLods().levels.size() * sizeof(LodLevel);
+    }
+
+    out.close();
+
+    if (!out || std::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+      std::cerr << "Error: Unable to write mesh cache " << path << std::endl;
+      std::remove(tempPath.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
+  bool MeshCache::open(const std::string& sourcePath, const SourceFingerprint& fingerprint)
+  {
+    this->meshes.clear();
+
+    // MeshCache::write refreshes the loose copy, so it must win over whatever the pack shipped with.
+    if (!this->file.open(cachePath(sourcePath), AssetLookup::LooseFirst)) return false;
+
+    const unsigned char* data = this->file.data();
+    uint64_t size = this->file.size();
+
+    if (size < sizeof(MeshCacheHeader)) return false;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != MESH_CACHE_VERSION ||
+      header.sourceSize != fingerprint.size ||
+      header.sourceHash != fingerprint.hash ||
+      header.processingHash != fingerprint.processing)
+    {
+      return false;
+    }
+
+    if (size < sizeof(MeshCacheHeader) + static_cast<uint64_t>(header.meshCount) * sizeof(MeshCacheEntry)) return false;
+
+    const MeshCacheEntry* entries = reinterpret_cast<const MeshCacheEntry*>(data + sizeof(MeshCacheHeader));
+
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+      const MeshCacheEntry& entry = entries[i];
+
+      uint64_t stride = entry.vertexFormat == static_cast<uint32_t>(VertexFormat::Packed) ? sizeof(PackedVertex) : sizeof(Vertex);
+
+      if (entry.vertexFormat > static_cast<uint32_t>(VertexFormat::Packed) ||
+        entry.vertexOffset + static_cast<uint64_t>(entry.vertexCount) * stride > size ||
+        (entry.indexType != GL_UNSIGNED_SHORT && entry.indexType != GL_UNSIGNED_INT) ||
+        entry.indexOffset + static_cast<uint64_t>(entry.indexCount) * indexSize(entry.indexType) > size ||
+        entry.meshletOffset + static_cast<uint64_t>(entry.meshletCount) * sizeof(Meshlet) > size ||
+        entry.lodOffset + static_cast<uint64_t>(entry.lodCount) * sizeof(LodLevel) > size)
+      {
+        std::cerr << "Error: Mesh cache for " << sourcePath << " is truncated" << std::endl;
+        this->meshes.clear();
+        return false;
+      }
+
+      CachedMesh mesh;
+      mesh.vertexFormat = static_cast<VertexFormat>(entry.vertexFormat);
+      mesh.vertices = mesh.vertexFormat == VertexFormat::Float ? reinterpret_cast<const Vertex*>(data + entry.vertexOffset) : nullptr;
+      mesh.packedVertices = mesh.vertexFormat == VertexFormat::Packed ? reinterpret_cast<const PackedVertex*>(data + entry.vertexOffset) : nullptr;
+      mesh.quantization.offset = glm::vec3(entry.positionOffset[0], entry.positionOffset[1], entry.positionOffset[2]);
+      mesh.quantization.scale = glm::vec3(entry.positionScale[0], entry.positionScale[1], entry.positionScale[2]);
+      mesh.vertexCount = entry.vertexCount;
+      mesh.indices = data + entry.indexOffset;
+      mesh.indexType = entry.indexType;
+      mesh.indexCount = entry.indexCount;
+      mesh.meshlets = reinterpret_cast<const Meshlet*>(data + entry.meshletOffset);
+      mesh.meshletCount = entry.meshletCount;
+
+      const LodLevel* levels = reinterpret_cast<const LodLevel*>(data + entry.lodOffset);
+      mesh.lods.center = glm::vec3(entry.lodCenter[0], entry.lodCenter[1], entry.lodCenter[2]);
+      mesh.lods.radius = entry.lodRadius;
+      mesh.lods.levels.assign(levels, levels + entry.lodCount);
+
+      uint64_t textureOffset = entry.textureOffset;
+      for (uint32_t j = 0; j < entry.textureCount; j++)
+      {
+        uint32_t lengths[2];
+        if (textureOffset + sizeof(lengths) > size) return false;
+        std::memcpy(lengths, data + textureOffset, sizeof(lengths));
+        textureOffset += sizeof(lengths);
+
+        if (textureOffset + lengths[0] + lengths[1] > size) return false;
+
+        CachedTexture texture;
+        texture.type.assign(reinterpret_cast<const char*>(data + textureOffset), lengths[0]);
+        textureOffset += lengths[0];
+        texture.path.assign(reinterpret_cast<const char*>(data + textureOffset), lengths[1]);
+        textureOffset += lengths[1];
+
+        mesh.textures.push_back(texture);
+      }
+
+      this->meshes.push_back(mesh);
+    }
+
+    return true;
+  }
+
+  const std::vector<CachedMesh>& MeshCache::getMeshes() const
+  {
+    return this->meshes;
+  }
+}
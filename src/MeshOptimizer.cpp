@@ -0,0 +1,300 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+namespace Model
+{
+  VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+  {
+    VertexCacheStats stats;
+    stats.acmr = 0.0f;
+    stats.atvr = 0.0f;
+
+    if (indices.size() < 3 || vertexCount == 0) return stats;
+
+    // A vertex is resident if it entered the FIFO fewer than cacheSize misses ago.
+    std::vector<uint64_t> entered(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint64_t misses = 0;
+    size_t uniqueVertices = 0;
+
+    for (unsigned int index : indices)
+    {
+      if (!referenced[index])
+      {
+        referenced[index] = true;
+        uniqueVertices++;
+      }
+
+      if (entered[index] == 0 || misses + 1 - entered[index] > cacheSize)
+      {
+        misses++;
+        entered[index] = misses;
+      }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+
+    return stats;
+  }
+
+  std::vector<unsigned int> optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+  {
+    std::vector<unsigned int> clusters;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return clusters;
+
+    // Vertex -> triangle adjacency in compressed rows.
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices) liveTriangles[index]++;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int timestamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    auto nextFromDeadEnd = [&]() -> long long
+    {
+      while (!deadEnd.empty())
+      {
+        unsigned int vertex = deadEnd.back();
+        deadEnd.pop_back();
+        if (liveTriangles[vertex] > 0) return vertex;
+      }
+
+      while (cursor < vertexCount)
+      {
+        if (liveTriangles[cursor] > 0) return static_cast<long long>(cursor);
+        cursor++;
+      }
+
+      return -1;
+    };
+
+    long long fanning = nextFromDeadEnd();
+    bool fromDeadEnd = true;
+
+    while (fanning >= 0)
+    {
+      candidates.clear();
+
+      for (unsigned int a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+      {
+        unsigned int triangle = adjacency[a];
+        if (emitted[triangle]) continue;
+
+        if (fromDeadEnd)
+        {
+          clusters.push_back(static_cast<unsigned int>(output.size() / 3));
+          fromDeadEnd = false;
+        }
+
+        for (unsigned int corner = 0; corner < 3; corner++)
+        {
+          unsigned int vertex = indices[triangle * 3 + corner];
+          output.push_back(vertex);
+          deadEnd.push_back(vertex);
+          candidates.push_back(vertex);
+          liveTriangles[vertex]--;
+
+          if (timestamp - cacheTime[vertex] > cacheSize)
+          {
+            cacheTime[vertex] = timestamp;
+            timestamp++;
+          }
+        }
+
+        emitted[triangle] = true;
+      }
+
+      // Prefer the candidate that stays in cache longest while its remaining fan is emitted.
+      long long best = -1;
+      int bestPriority = -1;
+
+      for (unsigned int vertex : candidates)
+      {
+        if (liveTriangles[vertex] == 0) continue;
+
+        int priority = 0;
+        if (timestamp - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize)
+        {
+          priority = static_cast<int>(timestamp - cacheTime[vertex]);
+        }
+
+        if (priority > bestPriority)
+        {
+          best = vertex;
+          bestPriority = priority;
+        }
+      }
+
+      if (best < 0)
+      {
+        best = nextFromDeadEnd();
+        fromDeadEnd = true;
+      }
+
+      fanning = best;
+    }
+
+    indices.swap(output);
+
+    return clusters;
+  }
+
+  void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& clusters, unsigned int cacheSize)
+  {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) return;
+
+    float targetACMR = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr * OVERDRAW_CLUSTER_THRESHOLD;
+
+    // Soft boundaries: cut a cluster wherever it has been cache efficient enough on its own. Each
+    // piece is simulated from a cold cache because sorting may move it away from its neighbours.
+    std::vector<unsigned int> boundaries;
+    std::vector<uint64_t> entered(vertices.size(), 0);
+    uint64_t misses = 0;
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+      size_t begin = clusters[c];
+      size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+      size_t start = begin;
+      uint64_t startMisses = misses;
+
+      boundaries.push_back(static_cast<unsigned int>(begin));
+
+      for (size_t t = begin; t < end; t++)
+      {
+        for (size_t corner = 0; corner < 3; corner++)
+        {
+          unsigned int index = indices[t * 3 + corner];
+          if (entered[index] <= startMisses || misses + 1 - entered[index] > cacheSize)
+          {
+            misses++;
+            entered[index] = misses;
+          }
+        }
+
+        size_t length = t + 1 - start;
+        if (t + 1 < end && static_cast<float>(misses - startMisses) / static_cast<float>(length) <= targetACMR)
+        {
+          boundaries.push_back(static_cast<unsigned int>(t + 1));
+          start = t + 1;
+          startMisses = misses;
+        }
+      }
+    }
+
+    // Area-weighted centroid and normal of the mesh and of each cluster.
+    size_t clusterCount = boundaries.size();
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> areas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+      size_t end = c + 1 < clusterCount ? boundaries[c + 1] : triangleCount;
+
+      for (size_t t = boundaries[c]; t < end; t++)
+      {
+        const glm::vec3& a = vertices[indices[t * 3]].position;
+        const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+
+        glm::vec3 normal = glm::cross(b - a, d - a);
+        float area = glm::length(normal);
+
+        centroids[c] += (a + b + d) * (area / 3.0f);
+        normals[c] += normal;
+        areas[c] += area;
+      }
+
+      meshCentroid += centroids[c];
+      meshArea += areas[c];
+    }
+
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+      if (areas[c] <= 0.0f) continue;
+
+      glm::vec3 centroid = centroids[c] / areas[c];
+      float normalLength = glm::length(normals[c]);
+      if (normalLength > 0.0f) sortKeys[c] = glm::dot(centroid - meshCentroid, normals[c] / normalLength);
+    }
+
+    std::vector<unsigned int> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    for (unsigned int c : order)
+    {
+      size_t end = c + 1 < clusterCount ? boundaries[c + 1] : triangleCount;
+      output.insert(output.end(), indices.begin() + boundaries[c] * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(output);
+  }
+
+  void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    constexpr unsigned int UNASSIGNED = ~0u;
+
+    std::vector<unsigned int> remap(vertices.size(), UNASSIGNED);
+    std::vector<Vertex> output;
+    output.reserve(vertices.size());
+
+    for (unsigned int& index : indices)
+    {
+      if (remap[index] == UNASSIGNED)
+      {
+        remap[index] = static_cast<unsigned int>(output.size());
+        output.push_back(vertices[index]);
+      }
+
+      index = remap[index];
+    }
+
+    vertices.swap(output);
+  }
+
+  void optimizeMesh(MeshData& data)
+  {
+    VertexCacheStats before = analyzeVertexCache(data.indices, data.vertices.size());
+
+    std::vector<unsigned int> clusters = optimizeVertexCache(data.indices, data.vertices.size());
+    optimizeOverdraw(data.indices, data.vertices, clusters);
+    optimizeVertexFetch(data.vertices, data.indices);
+
+    VertexCacheStats after = analyzeVertexCache(data.indices, data.vertices.size());
+
+    data.stats.optimized = true;
+    data.stats.acmrBefore = before.acmr;
+    data.stats.atvrBefore = before.atvr;
+    data.stats.acmrAfter = after.acmr;
+    data.stats.atvrAfter = after.atvr;
+  }
+}
@@ -0,0 +1,159 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Mesh.h"
+
+namespace Model
+{
+  // Below this minimum normal agreement the cone is too wide to ever reject anything.
+  constexpr float MESHLET_CONE_MIN_SPREAD = 0.1f;
+
+  MeshletCullContext::MeshletCullContext(const glm::mat4& projection, const glm::mat4& view, const glm::mat4& model, bool backfaceCulling):
+    backfaceCulling(backfaceCulling)
+  {
+    // Gribb-Hartmann: the clip planes of projection * view * model are in object space.
+    glm::mat4 clip = glm::transpose(projection * view * model);
+
+    this->planes[0] = clip[3] + clip[0];
+    this->planes[1] = clip[3] - clip[0];
+    this->planes[2] = clip[3] + clip[1];
+    this->planes[3] = clip[3] - clip[1];
+    this->planes[4] = clip[3] + clip[2];
+    this->planes[5] = clip[3] - clip[2];
+
+    for (glm::vec4& plane : this->planes)
+    {
+      plane /= glm::length(glm::vec3(plane));
+    }
+
+    this->cameraPosition = glm::vec3(glm::inverse(view * model) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+
+  static void computeBounds(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& meshletVertices, Meshlet& meshlet)
+  {
+    glm::vec3 minimum = vertices[meshletVertices[0]].position;
+    glm::vec3 maximum = minimum;
+
+    for (unsigned int vertex : meshletVertices)
+    {
+      minimum = glm::min(minimum, vertices[vertex].position);
+      maximum = glm::max(maximum, vertices[vertex].position);
+    }
+
+    meshlet.center = (minimum + maximum) * 0.5f;
+    meshlet.radius = 0.0f;
+
+    for (unsigned int vertex : meshletVertices)
+    {
+      meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+    }
+
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+
+    for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3)
+    {
+      const glm::vec3& a = vertices[indices[i]].position;
+      const glm::vec3& b = vertices[indices[i + 1]].position;
+      const glm::vec3& c = vertices[indices[i + 2]].position;
+
+      glm::vec3 normal = glm::cross(b - a, c - a);
+      float length = glm::length(normal);
+      if (length <= 0.0f) continue;
+
+      normal /= length;
+      normals.push_back(normal);
+      axis += normal;
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength <= 0.0f) return;
+
+    axis /= axisLength;
+
+    float minimumDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+    {
+      minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+    }
+
+    meshlet.coneAxis = axis;
+    if (minimumDot > MESHLET_CONE_MIN_SPREAD) meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+  }
+
+  std::vector<Meshlet> buildMeshlets(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices)
+  {
+    std::vector<Meshlet> meshlets;
+    if (indices.size() < 3) return meshlets;
+
+    // Marks which meshlet last used a vertex so membership checks stay O(1).
+    std::vector<uint32_t> owner(vertices.size(), ~0u);
+    std::vector<unsigned int> meshletVertices;
+
+    Meshlet current;
+    current.firstIndex = 0;
+    current.indexCount = 0;
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      uint32_t id = static_cast<uint32_t>(meshlets.size());
+      unsigned int added = 0;
+
+      for (size_t j = 0; j < 3; j++)
+      {
+        if (owner[indices[i + j]] != id) added++;
+      }
+
+      bool full = meshletVertices.size() + added > MESHLET_MAX_VERTICES || current.indexCount / 3 + 1 > MESHLET_MAX_TRIANGLES;
+
+      if (full)
+      {
+        computeBounds(indices, vertices, meshletVertices, current);
+        meshlets.push_back(current);
+
+        id++;
+        meshletVertices.clear();
+        current.firstIndex = static_cast<uint32_t>(i);
+        current.indexCount = 0;
+      }
+
+      for (size_t j = 0; j < 3; j++)
+      {
+        unsigned int vertex = indices[i + j];
+        if (owner[vertex] != id)
+        {
+          owner[vertex] = id;
+          meshletVertices.push_back(vertex);
+        }
+      }
+
+      current.indexCount += 3;
+    }
+
+    computeBounds(indices, vertices, meshletVertices, current);
+    meshlets.push_back(current);
+
+    return meshlets;
+  }
+
+  bool isMeshletVisible(const Meshlet& meshlet, const MeshletCullContext& context)
+  {
+    for (const glm::vec4& plane : context.planes)
+    {
+      if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) return false;
+    }
+
+    if (!context.backfaceCulling) return true;
+
+    // Every triangle faces away when the view direction lies inside the normal cone, widened by the sphere.
+    glm::vec3 toCenter = meshlet.center - context.cameraPosition;
+    if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius) return false;
+
+    return true;
+  }
+}
@@ -1,44 +1,314 @@
 #include "Model.h"
 
-#include "stb_image.h"
+#include <algorithm>
+#include <unordered_map>
+
+#include "AssetIOSystem.h"
+#include "Hash.h"
+#include "MeshOptimizer.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+#include "UploadRing.h"
 
 namespace Model
 {
-  Model::Model(std::string path)
+  uint64_t ModelOptions::hash() const
+  {
+    uint32_t flags[6] = {
+      static_cast<uint32_t>(this->importer),
+      this->weldVertices ? 1u : 0u,
+      this->optimizeMeshes ? 1u : 0u,
+      this->buildMeshlets ? 1u : 0u,
+      this->lodLevels,
+      static_cast<uint32_t>(this->vertexFormat)
+    };
+    float tolerances[3] = { this->weldTolerance.position, this->weldTolerance.normal, this->weldTolerance.texCoords };
+
+    return hashBytes(tolerances, sizeof(tolerances), hashBytes(flags, sizeof(flags)));
+  }
+
+  Model::Model(std::string path, ModelOptions options):
+    options(options),
+    hasFingerprint(false),
+    loading(false),
+    nextPendingMesh(0)
   {
     this->loadModel(path);
   }
 
-  void Model::draw(Shader& shader)
+  Model::~Model()
   {
+    // Worker tasks read the importer's scene, so they have to finish before it is released.
+    for (size_t i = this->nextPendingMesh; i < this->pendingMeshes.size(); i++)
+    {
+      this->pendingMeshes[i].wait();
+    }
+  }
+
+  void Model::drawInstanced(Shader& shader, const glm::mat4* transforms, size_t count)
+  {
+    if (count == 0) return;
+
+    UploadRing& ring = UploadRing::shared();
+    UploadAllocation instances = ring.upload(transforms, count * sizeof(glm::mat4), sizeof(glm::vec4));
+    if (!instances.data)
+    {
+      std::cerr << "ERROR: No upload ring space for " << count << " instances of " << this->path << std::endl;
+      return;
+    }
+
+    ring.flush();
+    GeometryHeap::shared().invalidateBinding();
+
     for (unsigned int i = 0; i < this->meshes.size(); i++)
     {
-      this->meshes[i].draw(shader);
+      this->meshes[i].drawInstanced(shader, ring.getBuffer(), instances.offset, static_cast<GLsizei>(count));
     }
   }
 
+  void Model::drawInstanced(Shader& shader, const std::vector<glm::mat4>& transforms)
+  {
+    this->drawInstanced(shader, transforms.data(), transforms.size());
+  }
+
+  void Model::enqueue(RenderQueue& queue, Shader& shader, uint32_t transform, const MeshletCullContext& cull, const LodSelector& lod, RenderPass pass)
+  {
+    this->cullStats = MeshletCullStats();
+    this->lodStats = LodStats();
+
+    for (const Mesh& mesh : this->meshes)
+    {
+      const LodChain& lods = mesh.getLods();
+      unsigned int level = lod.select(lods);
+
+      if (!lods.levels.empty())
+      {
+        this->lodStats.fullDetailTriangles += lods.levels[0].indexCount / 3;
+        this->lodStats.trianglesDrawn += lods.levels[level].indexCount / 3;
+      }
+
+      queue.push(pass, shader, mesh, transform, level, &cull, &this->cullStats);
+    }
+  }
+
+  const MeshletCullStats& Model::getCullStats() const
+  {
+    return this->cullStats;
+  }
+
+  const LodStats& Model::getLodStats() const
+  {
+    return this->lodStats;
+  }
+
+  GeometryMemory Model::getMemory() const
+  {
+    GeometryMemory total;
+    for (const Mesh& mesh : this->meshes)
+    {
+      GeometryMemory memory = mesh.getMemory();
+      total.cpuBytes += memory.cpuBytes;
+      total.gpuBytes += memory.gpuBytes;
+    }
+
+    return total;
+  }
+
+  void Model::uploadPending(unsigned int maxMeshes)
+  {
+    unsigned int uploaded = 0;
+
+    // Meshes are consumed strictly in submission order so the mesh list is deterministic.
+    while (uploaded < maxMeshes && this->nextPendingMesh < this->pendingMeshes.size())
+    {
+      std::future<MeshData>& pending = this->pendingMeshes[this->nextPendingMesh];
+      if (pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) break;
+
+      this->uploadMesh(pending.get());
+      this->nextPendingMesh++;
+      uploaded++;
+    }
+
+    if (this->loading && this->nextPendingMesh == this->pendingMeshes.size())
+    {
+      this->pendingMeshes.clear();
+      this->nextPendingMesh = 0;
+      this->importer.reset();
+      this->loading = false;
+
+      // Meshes are still CPU-resident here, so their size is what the import produced.
+      if (this->importArena)
+      {
+        reportImport(this->path, this->importArena->getStats(), this->getMemory().cpuBytes);
+        this->importArena.reset();
+      }
+
+      this->reportProcessing();
+      if (this->hasFingerprint) MeshCache::write(this->path, this->fingerprint, this->meshes);
+
+      // The cache writer reads the CPU arrays, so they can only go once it is done.
+      for (Mesh& mesh : this->meshes) mesh.applyResidency(this->options.residency);
+      this->reportMemory();
+    }
+  }
+
+  void Model::finishLoading()
+  {
+    for (size_t i = this->nextPendingMesh; i < this->pendingMeshes.size(); i++)
+    {
+      this->pendingMeshes[i].wait();
+    }
+
+    this->uploadPending(static_cast<unsigned int>(this->pendingMeshes.size()));
+  }
+
+  bool Model::isLoaded() const
+  {
+    return !this->loading;
+  }
+
   void Model::loadModel(std::string path)
   {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    this->path = path;
+    this->directory = path.substr(0, path.find_last_of('/'));
+
+    this->hasFingerprint = MeshCache::fingerprint(path, this->fingerprint);
+    this->fingerprint.processing = this->options.hash();
+
+    if (this->hasFingerprint && this->loadCache(path, this->fingerprint)) return;
+
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    if (this->options.importer == ModelImporter::NativeObj && extension == "obj")
+    {
+      if (this->loadNativeObj(path)) return;
+
+      std::cerr << "Native OBJ import failed for " << path << ", falling back to Assimp" << std::endl;
+    }
+
+    this->importer = std::make_unique<Assimp::Importer>();
+    this->importer->SetIOHandler(new AssetIOSystem());
+    const aiScene* scene = this->importer->ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
     if (!scene || scene->mFlags == AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
     {
-      std::cout << "Error: Unable to load model from " << path << "\n " << importer.GetErrorString() << std::endl;
+      std::cout << "Error: Unable to load model from " << path << "\n " << this->importer->GetErrorString() << std::endl;
+      this->importer.reset();
       return;
     }
 
-    this->directory = path.substr(0, path.find_last_of('/'));
+    this->importArena = std::make_unique<ImportArena>();
+    this->loading = true;
     this->processNode(scene->mRootNode, scene);
   }
 
+  bool Model::loadCache(const std::string& path, const SourceFingerprint& fingerprint)
+  {
+    // Shared by every mesh that keeps views into the mapping, and unmapped when the last one lets go.
+    std::shared_ptr<MeshCache> cache = std::make_shared<MeshCache>();
+    if (!cache->open(path, fingerprint)) return false;
+
+    // Reading and hashing the texture files runs on the pool, one task per distinct file, as on the import path;
+    // only the registry lookups below stay on the GL thread.
+    ThreadPool& pool = ThreadPool::shared();
+    std::unordered_map<std::string, std::future<TextureSource>> sources;
+    for (const CachedMesh& cachedMesh : cache->getMeshes())
+    {
+      for (const CachedTexture& cachedTexture : cachedMesh.textures)
+      {
+        if (sources.count(cachedTexture.path)) continue;
+
+        std::string texturePath = this->directory + '/' + cachedTexture.path;
+        sources.emplace(cachedTexture.path, pool.submit([texturePath]() { return TextureRegistry::shared().describe(texturePath); }));
+      }
+    }
+
+    std::unordered_map<std::string, TextureSource> described;
+    for (auto& entry : sources)
+    {
+      described.emplace(entry.first, entry.second.get());
+    }
+
+    for (const CachedMesh& cachedMesh : cache->getMeshes())
+    {
+      std::vector<Texture> textures;
+      for (const CachedTexture& cachedTexture : cachedMesh.textures)
+      {
+        textures.push_back(this->loadTexture(described[cachedTexture.path], aiString(cachedTexture.path), cachedTexture.type));
+      }
+
+      // Every mode uploads straight from the mapping. The CPU copy stays a view into it; applyResidency
+      // copies out only what Positions needs, and Keep copies nothing until Mesh::loadCpuGeometry().
+      const void* vertices;
+      if (cachedMesh.vertexFormat == VertexFormat::Packed)
+      {
+        vertices = cachedMesh.packedVertices;
+        this->meshes.push_back(Mesh(cachedMesh.packedVertices, cachedMesh.vertexCount, cachedMesh.quantization, cachedMesh.indices, cachedMesh.indexType, cachedMesh.indexCount, textures));
+      }
+      else
+      {
+        vertices = cachedMesh.vertices;
+        this->meshes.push_back(Mesh(cachedMesh.vertices, cachedMesh.vertexCount, cachedMesh.indices, cachedMesh.indexType, cachedMesh.indexCount, textures));
+      }
+
+      if (this->options.residency != GeometryResidency::Discard)
+      {
+        this->meshes.back().setMappedGeometry(cache, vertices, cachedMesh.vertexCount, cachedMesh.indices, cachedMesh.indexCount);
+      }
+
+      this->meshes.back().setMeshlets(std::vector<Meshlet>(cachedMesh.meshlets, cachedMesh.meshlets + cachedMesh.meshletCount));
+      this->meshes.back().setLods(cachedMesh.lods);
+      this->meshes.back().applyResidency(this->options.residency);
+    }
+
+    this->reportMemory();
+
+    return true;
+  }
+
+  bool Model::loadNativeObj(const std::string& path)
+  {
+    std::vector<MeshData> meshes;
+
+    // Parse and weld scratch share one arena, released in one go once every mesh is uploaded.
+    this->importArena = std::make_unique<ImportArena>();
+    if (!loadObj(path, meshes, *this->importArena))
+    {
+      this->importArena.reset();
+      return false;
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    ModelOptions options = this->options;
+    std::string directory = this->directory;
+    ImportArena* arena = this->importArena.get();
+
+    this->pendingMeshes.reserve(meshes.size());
+    this->meshes.reserve(meshes.size());
+
+    for (MeshData& mesh : meshes)
+    {
+      this->pendingMeshes.push_back(pool.submit([data = std::move(mesh), options, directory, arena]() mutable { return postProcessMesh(std::move(data), options, directory, arena); }));
+    }
+
+    this->loading = true;
+
+    return true;
+  }
+
   void Model::processNode(aiNode* node, const aiScene* scene)
   {
+    ThreadPool& pool = ThreadPool::shared();
+    ModelOptions options = this->options;
+    std::string directory = this->directory;
+    ImportArena* arena = this->importArena.get();
+
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-      aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+      const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 
-      this->meshes.push_back(this->processMesh(mesh, scene));
+      this->pendingMeshes.push_back(pool.submit([mesh, scene, options, directory, arena]() { return postProcessMesh(processMesh(mesh, scene), options, directory, arena); }));
     }
 
     for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -47,11 +317,121 @@ namespace Model
     }
   }
 
-  Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+  void Model::uploadMesh(MeshData data)
   {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    // Texture files were resolved and hashed on the worker; the registry creates or shares the GL objects here.
+    for (size_t i = 0; i < data.textures.size(); i++)
+    {
+      data.textures[i] = this->loadTexture(data.textureSources[i], data.textures[i].path, data.textures[i].type);
+    }
+
+    this->processingStats.push_back(data.stats);
+    std::vector<Meshlet> meshlets = std::move(data.meshlets);
+    LodChain lods = std::move(data.lods);
+
+    if (data.vertexFormat == VertexFormat::Packed)
+    {
+      this->meshes.push_back(Mesh(std::move(data.packedVertices), data.quantization, std::move(data.indices), std::move(data.textures)));
+    }
+    else
+    {
+      this->meshes.push_back(Mesh(std::move(data.vertices), std::move(data.indices), std::move(data.textures)));
+    }
+
+    this->meshes.back().setMeshlets(std::move(meshlets));
+    this->meshes.back().setLods(std::move(lods));
+  }
+
+  void Model::reportImport(const std::string& path, const ImportArenaStats& scratch, size_t outputBytes)
+  {
+    // Only arena traffic is counted; the importer's own buffers and the texture decodes are not.
+    std::cout << "Import of " << path << ": " << scratch.allocations << " arena allocations served from "
+      << scratch.blocks << " heap blocks, arena footprint " << scratch.bytesReserved / (1024.0 * 1024.0) << " MB ("
+      << scratch.bytesAllocated / (1024.0 * 1024.0) << " MB requested), " << outputBytes / (1024.0 * 1024.0)
+      << " MB mesh data" << std::endl;
+  }
+
+  void Model::reportMemory() const
+  {
+    GeometryMemory memory = this->getMemory();
+    const char* residency = this->options.residency == GeometryResidency::Keep ? "keep" : this->options.residency == GeometryResidency::Discard ? "discard" : "positions";
+
+    std::cout << "Resident geometry for " << this->path << " (" << residency << "): " << memory.cpuBytes / (1024.0 * 1024.0)
+      << " MB CPU, " << memory.gpuBytes / (1024.0 * 1024.0) << " MB GPU" << std::endl;
+  }
+
+  void Model::reportProcessing() const
+  {
+    if (!this->options.weldVertices && !this->options.optimizeMeshes && !this->options.buildMeshlets && this->options.lodLevels == 0 && this->options.vertexFormat == VertexFormat::Float) return;
+
+    std::cout << "Mesh processing for " << this->path << ":" << std::endl;
+
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    size_t vertexBytesBefore = 0;
+    size_t vertexBytesAfter = 0;
+
+    for (size_t i = 0; i < this->processingStats.size(); i++)
+    {
+      const MeshProcessingStats& stats = this->processingStats[i];
+      std::cout << "  mesh " << i << ":";
+
+      if (stats.welded)
+      {
+        std::cout << " vertices " << stats.verticesBefore << " -> " << stats.verticesAfter;
+        verticesBefore += stats.verticesBefore;
+        verticesAfter += stats.verticesAfter;
+      }
+
+      if (stats.optimized)
+      {
+        std::cout << " ACMR " << stats.acmrBefore << " -> " << stats.acmrAfter
+          << ", ATVR " << stats.atvrBefore << " -> " << stats.atvrAfter;
+      }
+
+      if (stats.meshletCount > 0)
+      {
+        std::cout << " meshlets " << stats.meshletCount;
+      }
+
+      if (!stats.lodTriangles.empty())
+      {
+        std::cout << " LOD triangles";
+        for (unsigned int triangles : stats.lodTriangles) std::cout << " " << triangles;
+      }
+
+      if (stats.quantized)
+      {
+        std::cout << " vertex bytes " << stats.vertexBytesBefore << " -> " << stats.vertexBytesAfter;
+        vertexBytesBefore += stats.vertexBytesBefore;
+        vertexBytesAfter += stats.vertexBytesAfter;
+      }
+
+      std::cout << std::endl;
+    }
+
+    if (this->options.weldVertices)
+    {
+      std::cout << "  welding: " << verticesBefore << " -> " << verticesAfter << " vertices, "
+        << (verticesBefore - verticesAfter) * sizeof(Vertex) / 1024.0 << " KB saved" << std::endl;
+    }
+
+    if (this->options.vertexFormat == VertexFormat::Packed)
+    {
+      // The CPU copy and the VBO hold the same packed array, so both shrink by the same amount.
+      std::cout << "  quantization: " << vertexBytesBefore / 1024.0 << " KB -> " << vertexBytesAfter / 1024.0
+        << " KB vertex data, " << (vertexBytesBefore - vertexBytesAfter) / 1024.0 << " KB saved on both CPU and GPU" << std::endl;
+    }
+  }
+
+  MeshData Model::processMesh(const aiMesh* mesh, const aiScene* scene)
+  {
+    MeshData data;
+    data.vertices.reserve(mesh->mNumVertices);
+
+    size_t indexCount = 0;
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) indexCount += mesh->mFaces[i].mNumIndices;
+    data.indices.reserve(indexCount);
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
@@ -82,98 +462,80 @@ namespace Model
         vertex.texCoords = glm::vec2(0.0f, 0.0f);
       }
 
-      vertices.push_back(vertex);
+      data.vertices.push_back(vertex);
     }
 
     for (unsigned int i = 0; i < mesh->mNumFaces; i++)
     {
-      aiFace face = mesh->mFaces[i];
+      const aiFace& face = mesh->mFaces[i];
 
       for (unsigned int j = 0; j < face.mNumIndices; j++)
       {
-        indices.push_back(face.mIndices[j]);
+        data.indices.push_back(face.mIndices[j]);
       }
     }
 
-    if (mesh->mMaterialIndex >= 0)
+    if (mesh->mMaterialIndex < scene->mNumMaterials)
     {
-      aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-      std::vector<Texture> diffuseMaps = this->loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-      textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+      const aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 
-      std::vector<Texture> specularMaps = this->loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-      textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+      collectMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", data.textures);
+      collectMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", data.textures);
     }
 
-    return Mesh(vertices, indices, textures);
+    return data;
   }
 
-  std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+  MeshData Model::postProcessMesh(MeshData data, const ModelOptions& options, const std::string& directory, ImportArena* arena)
   {
-    std::vector<Texture> textures;
-
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    TextureRegistry& registry = TextureRegistry::shared();
+    for (const Texture& texture : data.textures)
     {
-      aiString str;
-      mat->GetTexture(type, i, &str);
-
-      unsigned char skip = false;
-      for (unsigned int j = 0; j < texturesLoaded.size(); j++)
-      {
-        if (texturesLoaded[j].path == str)
-        {
-          textures.push_back(texturesLoaded[j]);
-          skip = true;
-
-          break;
-        }
-      }
-
-      if (!skip)
-      {
-        Texture texture;
-        texture.id = TextureFromFile(str.C_Str(), this->directory);
-        texture.type = typeName;
-        texture.path = str;
-        textures.push_back(texture);
-
-        this->texturesLoaded.push_back(texture);
-      }
+      data.textureSources.push_back(registry.describe(directory + '/' + texture.path.C_Str()));
     }
 
-    return textures;
-  }
-}
+    if (options.weldVertices) weldVertices(data, options.weldTolerance, arena);
+    if (options.optimizeMeshes) optimizeMesh(data);
 
-unsigned int TextureFromFile(std::string path, const std::string& directory)
-{
-  std::string fileName = directory + '/' + path;
-  unsigned int textureId;
+    if (options.buildMeshlets)
+    {
+      data.meshlets = buildMeshlets(data.indices, data.vertices);
+      data.stats.meshletCount = data.meshlets.size();
+    }
 
-  glGenTextures(1, &textureId);
+    // Appended after the meshlets were cut so they only ever cover the full-detail range.
+    if (options.lodLevels > 0)
+    {
+      data.lods = generateLods(data.indices, data.vertices, options.lodLevels);
+      for (const LodLevel& level : data.lods.levels) data.stats.lodTriangles.push_back(level.indexCount / 3);
+    }
 
-  int width, height, nrChannels;
-  unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &nrChannels, 0);
+    if (options.vertexFormat == VertexFormat::Packed) quantizeVertices(data);
 
-  if (!data)
-  {
-    std::cerr << "Error: Failed to load texture from: " << path << std::endl;
-    stbi_image_free(data);
+    return data;
   }
 
-  glBindTexture(GL_TEXTURE_2D, textureId);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  void Model::collectMaterialTextures(const aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures)
+  {
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    {
+      Texture texture;
+      texture.id = 0;
+      texture.type = typeName;
+      mat->GetTexture(type, i, &texture.path);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+      textures.push_back(texture);
+    }
+  }
 
-  stbi_image_free(data);
+  Texture Model::loadTexture(const TextureSource& source, const aiString& path, const std::string& typeName)
+  {
+    Texture texture;
+    texture.handle = TextureRegistry::shared().acquire(source);
+    texture.id = texture.handle->id;
+    texture.type = typeName;
+    texture.path = path;
 
-  return textureId;
-}
\ No newline at end of file
+    return texture;
+  }
+}
@@ -0,0 +1,820 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <unordered_map>
+
+#include "ImportArena.h"
+#include "ThreadPool.h"
+#include "VirtualFileSystem.h"
+
+namespace Model
+{
+  constexpr size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+  constexpr int32_t OBJ_NO_INDEX = INT32_MIN;
+
+  static const double POWERS_OF_TEN[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  struct ObjCorner
+  {
+    // 0-based file-wide indices. Relative indices are resolved while parsing, because every chunk
+    // knows how many attributes the chunks before it hold from the counting pass.
+    int32_t index[3];
+  };
+
+  struct ObjFace
+  {
+    uint32_t firstCorner;
+    uint32_t cornerCount;
+    int32_t material;
+  };
+
+  struct ObjCounts
+  {
+    uint32_t positions, texCoords, normals, faces, corners;
+  };
+
+  enum class ObjLine
+  {
+    Other,
+    Position,
+    TexCoord,
+    Normal,
+    Face,
+    UseMaterial,
+    MaterialLibrary
+  };
+
+  // Attribute streams for the whole file, sized exactly once the chunks have been counted.
+  struct ObjGeometry
+  {
+    ArenaVector<glm::vec3> positions;
+    ArenaVector<glm::vec2> texCoords;
+    ArenaVector<glm::vec3> normals;
+
+    explicit ObjGeometry(ImportArena& arena):
+      positions(ArenaAllocator<glm::vec3>(arena)),
+      texCoords(ArenaAllocator<glm::vec2>(arena)),
+      normals(ArenaAllocator<glm::vec3>(arena))
+    {
+    }
+  };
+
+  struct ObjChunk
+  {
+    const char* begin;
+    const char* end;
+    ObjCounts counts;
+    ObjCounts bases;
+    ArenaVector<ObjCorner> corners;
+    ArenaVector<ObjFace> faces;
+    std::vector<std::string> materials;
+    std::vector<std::string> materialLibraries;
+
+    ObjChunk(const char* begin, const char* end, ImportArena& arena):
+      begin(begin),
+      end(end),
+      counts{ 0, 0, 0, 0, 0 },
+      bases{ 0, 0, 0, 0, 0 },
+      corners(ArenaAllocator<ObjCorner>(arena)),
+      faces(ArenaAllocator<ObjFace>(arena))
+    {
+    }
+  };
+
+  struct ObjMaterial
+  {
+    std::string name;
+    std::vector<Texture> textures;
+  };
+
+  static bool isDigit(char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+
+  static bool isSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  static void skipSpaces(const char*& p, const char* end)
+  {
+    while (p < end && isSpace(*p)) p++;
+  }
+
+  static const char* lineEnd(const char* p, const char* end)
+  {
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return newline ? newline : end;
+  }
+
+  // True when all eight bytes of the little-endian word are ASCII digits.
+  static bool isEightDigits(uint64_t word)
+  {
+    return (((word & 0xF0F0F0F0F0F0F0F0ull) | (((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+  }
+
+  static uint32_t parseEightDigits(uint64_t word)
+  {
+    word -= 0x3030303030303030ull;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFull) * 0x000F424000000064ull) + (((word >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+
+    return static_cast<uint32_t>(word);
+  }
+
+  // Significant digits a uint64 mantissa holds without overflowing.
+  constexpr int OBJ_MANTISSA_DIGITS = 19;
+
+  // Accumulates digits into `mantissa`, returning how many were consumed. `significant` is the budget
+  // shared by the integer and fraction parts: once it reaches OBJ_MANTISSA_DIGITS further digits only
+  // scale the value, so they are counted in `dropped` instead. Leading zeros do not use the budget.
+  static int parseDigits(const char*& p, const char* end, uint64_t& mantissa, int& significant, int& dropped)
+  {
+    int count = 0;
+
+    while (end - p >= 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, p, 8);
+      if (!isEightDigits(word) || significant + 8 > OBJ_MANTISSA_DIGITS) break;
+
+      mantissa = mantissa * 100000000ull + parseEightDigits(word);
+      if (mantissa != 0) significant += 8;
+      p += 8;
+      count += 8;
+    }
+
+    while (p < end && isDigit(*p))
+    {
+      if (significant < OBJ_MANTISSA_DIGITS)
+      {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        if (mantissa != 0) significant++;
+      }
+      else
+      {
+        dropped++;
+      }
+
+      p++;
+      count++;
+    }
+
+    return count;
+  }
+
+  float parseFloat(const char*& p, const char* end)
+  {
+    skipSpaces(p, end);
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+      negative = *p == '-';
+      p++;
+    }
+
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int dropped = 0;
+    parseDigits(p, end, mantissa, significant, dropped);
+    // Integer digits that did not fit still multiply the value.
+    int exponent = dropped;
+
+    if (p < end && *p == '.')
+    {
+      p++;
+
+      // Fraction digits that did not fit are skipped without touching the exponent.
+      int droppedFraction = 0;
+      int fractionDigits = parseDigits(p, end, mantissa, significant, droppedFraction);
+      exponent -= fractionDigits - droppedFraction;
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      p++;
+
+      bool negativeExponent = false;
+      if (p < end && (*p == '-' || *p == '+'))
+      {
+        negativeExponent = *p == '-';
+        p++;
+      }
+
+      int value = 0;
+      while (p < end && isDigit(*p))
+      {
+        if (value < 10000) value = value * 10 + (*p - '0');
+        p++;
+      }
+
+      exponent += negativeExponent ? -value : value;
+    }
+
+    double result = static_cast<double>(mantissa);
+
+    while (exponent > 22)
+    {
+      result *= 1e22;
+      exponent -= 22;
+    }
+
+    while (exponent < -22)
+    {
+      result /= 1e22;
+      exponent += 22;
+    }
+
+    result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+
+    return static_cast<float>(negative ? -result : result);
+  }
+
+  static bool parseIndex(const char*& p, const char* end, int32_t& value)
+  {
+    bool negative = false;
+    if (p < end && *p == '-')
+    {
+      negative = true;
+      p++;
+    }
+
+    if (p >= end || !isDigit(*p)) return false;
+
+    int32_t result = 0;
+    while (p < end && isDigit(*p))
+    {
+      result = result * 10 + (*p - '0');
+      p++;
+    }
+
+    value = negative ? -result : result;
+
+    return true;
+  }
+
+  static std::string parseName(const char* p, const char* end)
+  {
+    skipSpaces(p, end);
+
+    while (end > p && isSpace(end[-1])) end--;
+
+    return std::string(p, end);
+  }
+
+  // Identifies the statement on a line and advances `cursor` past its keyword.
+  static ObjLine classifyLine(const char*& cursor, const char* eol)
+  {
+    skipSpaces(cursor, eol);
+    ptrdiff_t length = eol - cursor;
+
+    if (length >= 2 && cursor[0] == 'v' && isSpace(cursor[1]))
+    {
+      cursor += 2;
+      return ObjLine::Position;
+    }
+
+    if (length >= 3 && cursor[0] == 'v' && cursor[1] == 't' && isSpace(cursor[2]))
+    {
+      cursor += 3;
+      return ObjLine::TexCoord;
+    }
+
+    if (length >= 3 && cursor[0] == 'v' && cursor[1] == 'n' && isSpace(cursor[2]))
+    {
+      cursor += 3;
+      return ObjLine::Normal;
+    }
+
+    if (length >= 2 && cursor[0] == 'f' && isSpace(cursor[1]))
+    {
+      cursor += 2;
+      return ObjLine::Face;
+    }
+
+    if (length > 7 && std::strncmp(cursor, "usemtl", 6) == 0 && isSpace(cursor[6]))
+    {
+      cursor += 7;
+      return ObjLine::UseMaterial;
+    }
+
+    if (length > 7 && std::strncmp(cursor, "mtllib", 6) == 0 && isSpace(cursor[6]))
+    {
+      cursor += 7;
+      return ObjLine::MaterialLibrary;
+    }
+
+    return ObjLine::Other;
+  }
+
+  // First pass: exact attribute, face and corner counts so the parse never grows a container.
+  static ObjCounts countChunk(const char* p, const char* end)
+  {
+    ObjCounts counts = { 0, 0, 0, 0, 0 };
+
+    while (p < end)
+    {
+      const char* eol = lineEnd(p, end);
+      const char* cursor = p;
+
+      switch (classifyLine(cursor, eol))
+      {
+      case ObjLine::Position: counts.positions++; break;
+      case ObjLine::TexCoord: counts.texCoords++; break;
+      case ObjLine::Normal: counts.normals++; break;
+      case ObjLine::Face:
+        counts.faces++;
+
+        // Tokenised exactly like parseFace so the corner count matches.
+        while (true)
+        {
+          skipSpaces(cursor, eol);
+          if (cursor >= eol) break;
+
+          counts.corners++;
+          while (cursor < eol && !isSpace(*cursor)) cursor++;
+        }
+        break;
+      default: break;
+      }
+
+      p = eol + 1;
+    }
+
+    return counts;
+  }
+
+  static void parseFace(const char* p, const char* end, ObjChunk& chunk, const ObjCounts& parsed, int32_t material)
+  {
+    ObjFace face;
+    face.firstCorner = static_cast<uint32_t>(chunk.corners.size());
+    face.cornerCount = 0;
+    face.material = material;
+
+    // Relative indices count back from the attributes seen so far in the whole file.
+    const int32_t counts[3] = {
+      static_cast<int32_t>(chunk.bases.positions + parsed.positions),
+      static_cast<int32_t>(chunk.bases.texCoords + parsed.texCoords),
+      static_cast<int32_t>(chunk.bases.normals + parsed.normals)
+    };
+
+    while (true)
+    {
+      skipSpaces(p, end);
+      if (p >= end) break;
+
+      ObjCorner corner;
+      corner.index[0] = corner.index[1] = corner.index[2] = OBJ_NO_INDEX;
+
+      for (int slot = 0; slot < 3; slot++)
+      {
+        int32_t value;
+        if (parseIndex(p, end, value)) corner.index[slot] = value < 0 ? counts[slot] + value : value - 1;
+
+        if (p >= end || *p != '/') break;
+        p++;
+      }
+
+      chunk.corners.push_back(corner);
+      face.cornerCount++;
+
+      // Skip anything unexpected so a malformed token cannot stall the parser.
+      while (p < end && !isSpace(*p)) p++;
+    }
+
+    if (face.cornerCount >= 3) chunk.faces.push_back(face);
+    else chunk.corners.resize(face.firstCorner);
+  }
+
+  // Second pass: attributes are written straight into the file-wide streams at the chunk's base.
+  static void parseChunk(ObjChunk& chunk, ObjGeometry& geometry)
+  {
+    chunk.corners.reserve(chunk.counts.corners);
+    chunk.faces.reserve(chunk.counts.faces);
+
+    glm::vec3* positions = geometry.positions.data() + chunk.bases.positions;
+    glm::vec2* texCoords = geometry.texCoords.data() + chunk.bases.texCoords;
+    glm::vec3* normals = geometry.normals.data() + chunk.bases.normals;
+
+    ObjCounts parsed = { 0, 0, 0, 0, 0 };
+    int32_t material = -1;
+
+    for (const char* p = chunk.begin; p < chunk.end;)
+    {
+      const char* eol = lineEnd(p, chunk.end);
+      const char* cursor = p;
+
+      switch (classifyLine(cursor, eol))
+      {
+      case ObjLine::Position:
+      {
+        glm::vec3& position = positions[parsed.positions++];
+        position.x = parseFloat(cursor, eol);
+        position.y = parseFloat(cursor, eol);
+        position.z = parseFloat(cursor, eol);
+        break;
+      }
+      case ObjLine::TexCoord:
+      {
+        glm::vec2& texCoord = texCoords[parsed.texCoords++];
+        texCoord.x = parseFloat(cursor, eol);
+        texCoord.y = parseFloat(cursor, eol);
+        break;
+      }
+      case ObjLine::Normal:
+      {
+        glm::vec3& normal = normals[parsed.normals++];
+        normal.x = parseFloat(cursor, eol);
+        normal.y = parseFloat(cursor, eol);
+        normal.z = parseFloat(cursor, eol);
+        break;
+      }
+      case ObjLine::Face:
+        parseFace(cursor, eol, chunk, parsed, material);
+        break;
+      case ObjLine::UseMaterial:
+        chunk.materials.push_back(parseName(cursor, eol));
+        material = static_cast<int32_t>(chunk.materials.size() - 1);
+        break;
+      case ObjLine::MaterialLibrary:
+        chunk.materialLibraries.push_back(parseName(cursor, eol));
+        break;
+      default:
+        break;
+      }
+
+      p = eol + 1;
+    }
+  }
+
+  static void loadMaterialLibrary(const std::string& path, std::vector<ObjMaterial>& materials)
+  {
+    AssetFile file;
+    if (!file.open(path))
+    {
+      std::cerr << "Error: Unable to open material library " << path << std::endl;
+      return;
+    }
+
+    const char* p = reinterpret_cast<const char*>(file.data());
+    const char* end = p + file.size();
+    ObjMaterial* current = nullptr;
+
+    while (p < end)
+    {
+      const char* eol = lineEnd(p, end);
+      const char* cursor = p;
+      skipSpaces(cursor, eol);
+
+      const char* keyEnd = cursor;
+      while (keyEnd < eol && !isSpace(*keyEnd)) keyEnd++;
+      std::string key(cursor, keyEnd);
+
+      if (key == "newmtl")
+      {
+        materials.push_back(ObjMaterial());
+        current = &materials.back();
+        current->name = parseName(keyEnd, eol);
+      }
+      else if (current && (key == "map_Kd" || key == "map_Ks"))
+      {
+        // Texture options come before the file name, so only the last token is the path.
+        std::string value = parseName(keyEnd, eol);
+        size_t separator = value.find_last_of(" \t");
+
+        Texture texture;
+        texture.id = 0;
+        texture.type = key == "map_Kd" ? "texture_diffuse" : "texture_specular";
+        texture.path = aiString(separator == std::string::npos ? value : value.substr(separator + 1));
+        current->textures.push_back(texture);
+      }
+
+      p = eol + 1;
+    }
+  }
+
+  struct CornerKey
+  {
+    int32_t position, texCoord, normal;
+
+    bool operator==(const CornerKey& other) const
+    {
+      return this->position == other.position && this->texCoord == other.texCoord && this->normal == other.normal;
+    }
+  };
+
+  struct CornerKeyHash
+  {
+    size_t operator()(const CornerKey& key) const
+    {
+      uint64_t hash = static_cast<uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+      hash ^= (static_cast<uint32_t>(key.texCoord) + 0x632BE59BD9B4E019ull + (hash << 6) + (hash >> 2));
+      hash ^= (static_cast<uint32_t>(key.normal) + 0x85EBCA77C2B2AE63ull + (hash << 6) + (hash >> 2));
+      return static_cast<size_t>(hash);
+    }
+  };
+
+  constexpr unsigned int OBJ_EMPTY_SLOT = UINT_MAX;
+
+  static MeshData buildMesh(const ObjGeometry& geometry, const ArenaVector<const ObjCorner*>& triangles, const ObjMaterial* material, ImportArena& arena)
+  {
+    MeshData data;
+    data.indices.reserve(triangles.size());
+
+    // Open-addressed table of indices into `unique`, at most three quarters full, so the whole lookup
+    // is one arena allocation instead of a heap node per vertex.
+    size_t capacity = 16;
+    while (capacity * 3 < triangles.size() * 4) capacity <<= 1;
+
+    ArenaVector<unsigned int> slots(capacity, OBJ_EMPTY_SLOT, ArenaAllocator<unsigned int>(arena));
+    ArenaVector<CornerKey> unique((ArenaAllocator<CornerKey>(arena)));
+    unique.reserve(triangles.size());
+
+    CornerKeyHash hasher;
+
+    // Deduplicate first so the vertex array is allocated once at its final size.
+    for (const ObjCorner* corner : triangles)
+    {
+      CornerKey key = { corner->index[0], corner->index[1], corner->index[2] };
+
+      size_t slot = hasher(key) & (capacity - 1);
+      while (slots[slot] != OBJ_EMPTY_SLOT && !(unique[slots[slot]] == key)) slot = (slot + 1) & (capacity - 1);
+
+      if (slots[slot] == OBJ_EMPTY_SLOT)
+      {
+        slots[slot] = static_cast<unsigned int>(unique.size());
+        unique.push_back(key);
+      }
+
+      data.indices.push_back(slots[slot]);
+    }
+
+    data.vertices.resize(unique.size());
+    bool missingNormals = false;
+
+    for (size_t i = 0; i < unique.size(); i++)
+    {
+      const CornerKey& key = unique[i];
+      Vertex& vertex = data.vertices[i];
+
+      bool validPosition = key.position >= 0 && key.position < static_cast<int32_t>(geometry.positions.size());
+      bool validTexCoord = key.texCoord >= 0 && key.texCoord < static_cast<int32_t>(geometry.texCoords.size());
+      bool validNormal = key.normal >= 0 && key.normal < static_cast<int32_t>(geometry.normals.size());
+
+      vertex.position = validPosition ? geometry.positions[key.position] : glm::vec3(0.0f);
+      vertex.normal = validNormal ? geometry.normals[key.normal] : glm::vec3(0.0f);
+      vertex.texCoords = validTexCoord ? geometry.texCoords[key.texCoord] : glm::vec2(0.0f);
+      vertex.texCoords.y = validTexCoord ? 1.0f - vertex.texCoords.y : 0.0f;
+
+      missingNormals |= !validNormal;
+    }
+
+    // Faces without normals get area-weighted smooth normals from their triangles.
+    if (missingNormals)
+    {
+      ArenaVector<glm::vec3> accumulated(data.vertices.size(), glm::vec3(0.0f), ArenaAllocator<glm::vec3>(arena));
+
+      for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+      {
+        const glm::vec3& a = data.vertices[data.indices[i]].position;
+        const glm::vec3& b = data.vertices[data.indices[i + 1]].position;
+        const glm::vec3& c = data.vertices[data.indices[i + 2]].position;
+        glm::vec3 normal = glm::cross(b - a, c - a);
+
+        for (size_t j = 0; j < 3; j++) accumulated[data.indices[i + j]] += normal;
+      }
+
+      for (size_t i = 0; i < data.vertices.size(); i++)
+      {
+        if (data.vertices[i].normal == glm::vec3(0.0f) && glm::dot(accumulated[i], accumulated[i]) > 0.0f)
+        {
+          data.vertices[i].normal = glm::normalize(accumulated[i]);
+        }
+      }
+    }
+
+    if (material) data.textures = material->textures;
+
+    return data;
+  }
+
+  std::vector<std::string> findMaterialLibraries(const std::string& path, const unsigned char* data, size_t size)
+  {
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::vector<std::string> libraries;
+
+    const char* p = reinterpret_cast<const char*>(data);
+    const char* end = p + size;
+
+    while (p < end)
+    {
+      const char* eol = lineEnd(p, end);
+      const char* cursor = p;
+
+      if (classifyLine(cursor, eol) == ObjLine::MaterialLibrary) libraries.push_back(directory + '/' + parseName(cursor, eol));
+
+      p = eol + 1;
+    }
+
+    return libraries;
+  }
+
+  bool loadObj(const std::string& path, std::vector<MeshData>& meshes, ImportArena& arena)
+  {
+    AssetFile file;
+    if (!file.open(path))
+    {
+      std::cerr << "Error: Unable to load model from " << path << std::endl;
+      return false;
+    }
+
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+
+    ThreadPool& pool = ThreadPool::shared();
+
+    // Split into roughly equal chunks that always end on a line break.
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(pool.size() * 4, file.size() / OBJ_MIN_CHUNK_SIZE));
+    size_t chunkSize = file.size() / chunkCount + 1;
+
+    std::vector<ObjChunk> chunks;
+    chunks.reserve(chunkCount + 1);
+    for (const char* chunkBegin = begin; chunkBegin < end;)
+    {
+      const char* chunkEnd = chunkBegin + std::min<size_t>(chunkSize, end - chunkBegin);
+      chunkEnd = chunkEnd < end ? lineEnd(chunkEnd, end) + 1 : end;
+      chunkEnd = std::min(chunkEnd, end);
+
+      chunks.emplace_back(chunkBegin, chunkEnd, arena);
+      chunkBegin = chunkEnd;
+    }
+
+    std::vector<std::future<void>> passes;
+    for (ObjChunk& chunk : chunks)
+    {
+      ObjChunk* target = &chunk;
+      passes.push_back(pool.submit([target]() { target->counts = countChunk(target->begin, target->end); }));
+    }
+
+    for (std::future<void>& pass : passes) pass.get();
+    passes.clear();
+
+    ObjCounts totals = { 0, 0, 0, 0, 0 };
+    for (ObjChunk& chunk : chunks)
+    {
+      chunk.bases = totals;
+      totals.positions += chunk.counts.positions;
+      totals.texCoords += chunk.counts.texCoords;
+      totals.normals += chunk.counts.normals;
+    }
+
+    ObjGeometry geometry(arena);
+    geometry.positions.resize(totals.positions);
+    geometry.texCoords.resize(totals.texCoords);
+    geometry.normals.resize(totals.normals);
+
+    ObjGeometry* target = &geometry;
+    for (ObjChunk& chunk : chunks)
+    {
+      ObjChunk* source = &chunk;
+      passes.push_back(pool.submit([source, target]() { parseChunk(*source, *target); }));
+    }
+
+    for (std::future<void>& pass : passes) pass.get();
+
+    // Resolve each face to a file-wide material slot and count the triangle corners per slot.
+    std::vector<std::string> materialNames;
+    std::unordered_map<std::string, int32_t> materialSlots;
+    std::vector<size_t> cornerCounts;
+    std::vector<std::string> libraries;
+    int32_t currentMaterial = -1;
+
+    for (ObjChunk& chunk : chunks)
+    {
+      std::vector<int32_t> localToGlobal(chunk.materials.size());
+      for (size_t i = 0; i < chunk.materials.size(); i++)
+      {
+        auto slot = materialSlots.find(chunk.materials[i]);
+        if (slot == materialSlots.end())
+        {
+          slot = materialSlots.emplace(chunk.materials[i], static_cast<int32_t>(materialNames.size())).first;
+          materialNames.push_back(chunk.materials[i]);
+          cornerCounts.push_back(0);
+        }
+
+        localToGlobal[i] = slot->second;
+      }
+
+      for (ObjFace& face : chunk.faces)
+      {
+        // Faces before the chunk's first usemtl continue whatever material the previous chunk ended on.
+        int32_t material = face.material >= 0 ? localToGlobal[face.material] : currentMaterial;
+        if (material < 0)
+        {
+          auto slot = materialSlots.emplace(std::string(), static_cast<int32_t>(materialNames.size()));
+          if (slot.second)
+          {
+            materialNames.push_back(std::string());
+            cornerCounts.push_back(0);
+          }
+
+          material = slot.first->second;
+        }
+
+        currentMaterial = material;
+        face.material = material;
+        cornerCounts[material] += (face.cornerCount - 2) * 3;
+      }
+
+      if (!chunk.materials.empty()) currentMaterial = localToGlobal.back();
+
+      libraries.insert(libraries.end(), chunk.materialLibraries.begin(), chunk.materialLibraries.end());
+    }
+
+    // Reject what the parser cannot represent rather than returning an empty or partial model.
+    size_t faceCount = 0;
+    for (const ObjChunk& chunk : chunks)
+    {
+      faceCount += chunk.faces.size();
+
+      for (const ObjCorner& corner : chunk.corners)
+      {
+        if (corner.index[0] < 0 || corner.index[0] >= static_cast<int32_t>(totals.positions))
+        {
+          std::cerr << "Error: " << path << " has a face corner without a valid vertex position" << std::endl;
+          return false;
+        }
+      }
+    }
+
+    if (faceCount == 0)
+    {
+      std::cerr << "Error: " << path << " contains no faces" << std::endl;
+      return false;
+    }
+
+    // Fan-triangulate into exactly sized per-material corner lists.
+    std::vector<ArenaVector<const ObjCorner*>> triangles;
+    triangles.reserve(materialNames.size());
+    for (size_t i = 0; i < materialNames.size(); i++)
+    {
+      triangles.emplace_back(ArenaAllocator<const ObjCorner*>(arena));
+      triangles.back().reserve(cornerCounts[i]);
+    }
+
+    for (const ObjChunk& chunk : chunks)
+    {
+      for (const ObjFace& face : chunk.faces)
+      {
+        ArenaVector<const ObjCorner*>& list = triangles[face.material];
+        const ObjCorner* corners = &chunk.corners[face.firstCorner];
+
+        for (uint32_t i = 1; i + 1 < face.cornerCount; i++)
+        {
+          list.push_back(&corners[0]);
+          list.push_back(&corners[i]);
+          list.push_back(&corners[i + 1]);
+        }
+      }
+    }
+
+    std::string directory = path.substr(0, path.find_last_of('/'));
+    std::vector<ObjMaterial> materials;
+    for (const std::string& library : libraries)
+    {
+      loadMaterialLibrary(directory + '/' + library, materials);
+    }
+
+    // One mesh per material, each built on its own worker.
+    std::vector<std::future<MeshData>> building;
+    for (size_t i = 0; i < materialNames.size(); i++)
+    {
+      if (triangles[i].empty()) continue;
+
+      const ObjMaterial* material = nullptr;
+      for (const ObjMaterial& candidate : materials)
+      {
+        if (candidate.name == materialNames[i]) material = &candidate;
+      }
+
+      const ArenaVector<const ObjCorner*>* meshTriangles = &triangles[i];
+      const ObjGeometry* meshGeometry = &geometry;
+      ImportArena* meshArena = &arena;
+      building.push_back(pool.submit([meshGeometry, meshTriangles, material, meshArena]() { return buildMesh(*meshGeometry, *meshTriangles, material, *meshArena); }));
+    }
+
+    meshes.reserve(meshes.size() + building.size());
+    for (std::future<MeshData>& mesh : building) meshes.push_back(mesh.get());
+
+    return true;
+  }
+}
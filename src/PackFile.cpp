@@ -0,0 +1,163 @@
+#include "PackFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Hash.h"
+
+constexpr uint64_t PACK_FILE_ALIGNMENT = 16;
+
+uint64_t PackFile::hashPath(const std::string& path)
+{
+  return hashBytes(path.data(), path.size());
+}
+
+bool PackFile::write(const std::string& outputPath, const std::string& root, const std::vector<std::string>& paths)
+{
+  std::vector<PackEntry> entries;
+  entries.reserve(paths.size());
+  std::string strings;
+
+  std::string tempPath = outputPath + ".tmp";
+  std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cerr << "Error: Unable to write pack file " << tempPath << std::endl;
+    return false;
+  }
+
+  // File data first, then the index and path strings, so the header can be patched at the end.
+  PackHeader header = {};
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  uint64_t offset = sizeof(header);
+
+  static const char zeros[PACK_FILE_ALIGNMENT] = {};
+
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    MappedFile source;
+    std::string sourcePath = root + '/' + paths[i];
+
+    // A skipped file gets no entry, so at run time the loose copy is found instead of an empty one.
+    if (!source.open(sourcePath))
+    {
+      std::cerr << "Warning: Skipping unreadable or empty file " << sourcePath << std::endl;
+      continue;
+    }
+
+    uint64_t aligned = (offset + PACK_FILE_ALIGNMENT - 1) & ~(PACK_FILE_ALIGNMENT - 1);
+    out.write(zeros, static_cast<std::streamsize>(aligned - offset));
+    offset = aligned;
+
+    PackEntry entry = {};
+    entry.pathHash = hashPath(paths[i]);
+    entry.pathOffset = static_cast<uint32_t>(strings.size());
+    entry.pathLength = static_cast<uint32_t>(paths[i].size());
+    entry.offset = offset;
+    entry.size = source.size();
+    entries.push_back(entry);
+    strings += paths[i];
+
+    out.write(reinterpret_cast<const char*>(source.data()), static_cast<std::streamsize>(source.size()));
+    offset += source.size();
+  }
+
+  std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) { return a.pathHash < b.pathHash; });
+
+  std::memcpy(header.magic, PACK_FILE_MAGIC, sizeof(header.magic));
+  header.version = PACK_FILE_VERSION;
+  header.entryCount = static_cast<uint32_t>(entries.size());
+  header.indexOffset = offset;
+  header.stringOffset = offset + entries.size() * sizeof(PackEntry);
+
+  out.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+  out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+
+  if (!out || std::rename(tempPath.c_str(), outputPath.c_str()) != 0)
+  {
+    std::cerr << "Error: Unable to write pack file " << outputPath << std::endl;
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool PackFile::open(const std::string& path)
+{
+  this->entries = nullptr;
+  this->strings = nullptr;
+  this->entryCount = 0;
+
+  if (!this->file.open(path)) return false;
+
+  const unsigned char* data = this->file.data();
+  uint64_t size = this->file.size();
+
+  PackHeader header;
+  if (size < sizeof(header)) return false;
+  std::memcpy(&header, data, sizeof(header));
+
+  if (std::memcmp(header.magic, PACK_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != PACK_FILE_VERSION ||
+    header.indexOffset > size || header.entryCount > (size - header.indexOffset) / sizeof(PackEntry) || header.stringOffset > size)
+  {
+    std::cerr << "Error: " << path << " is not a valid pack file" << std::endl;
+    this->file.close();
+    return false;
+  }
+
+  const PackEntry* entries = reinterpret_cast<const PackEntry*>(data + header.indexOffset);
+  uint64_t stringSize = size - header.stringOffset;
+
+  // Checked once here so find() can hand out views without any bounds checks of its own.
+  for (uint32_t i = 0; i < header.entryCount; i++)
+  {
+    const PackEntry& entry = entries[i];
+
+    if (entry.offset > size || entry.size > size - entry.offset || entry.pathOffset > stringSize || entry.pathLength > stringSize - entry.pathOffset)
+    {
+      std::cerr << "Error: " << path << " has an entry outside the file" << std::endl;
+      this->file.close();
+      return false;
+    }
+  }
+
+  this->entries = entries;
+  this->strings = reinterpret_cast<const char*>(data + header.stringOffset);
+  this->entryCount = header.entryCount;
+
+  return true;
+}
+
+bool PackFile::find(const std::string& path, const unsigned char*& data, size_t& size) const
+{
+  if (!this->entries) return false;
+
+  uint64_t hash = hashPath(path);
+  const PackEntry* end = this->entries + this->entryCount;
+  const PackEntry* entry = std::lower_bound(this->entries, end, hash, [](const PackEntry& a, uint64_t b) { return a.pathHash < b; });
+
+  for (; entry != end && entry->pathHash == hash; entry++)
+  {
+    if (entry->pathLength != path.size() || std::memcmp(this->strings + entry->pathOffset, path.data(), path.size()) != 0) continue;
+
+    data = this->file.data() + entry->offset;
+    size = entry->size;
+
+    return true;
+  }
+
+  return false;
+}
+
+uint32_t PackFile::getEntryCount() const
+{
+  return this->entryCount;
+}
@@ -0,0 +1,124 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint64_t capacity):
+  capacity(0),
+  used(0)
+{
+  this->reset(capacity, 0);
+}
+
+bool RangeAllocator::allocate(uint64_t size, uint64_t& offset)
+{
+  if (size == 0)
+  {
+    offset = 0;
+    return true;
+  }
+
+  // Among equally good fits the lowest offset wins, which keeps allocations packed towards the front.
+  auto fit = this->freeBySize.lower_bound(std::make_pair(size, static_cast<uint64_t>(0)));
+  if (fit == this->freeBySize.end()) return false;
+
+  uint64_t blockOffset = fit->second;
+  uint64_t blockSize = fit->first;
+
+  this->eraseFree(this->freeByOffset.find(blockOffset));
+  if (blockSize > size) this->insertFree(blockOffset + size, blockSize - size);
+
+  this->used += size;
+  offset = blockOffset;
+
+  return true;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size)
+{
+  if (size == 0) return;
+
+  this->used -= size;
+
+  auto next = this->freeByOffset.lower_bound(offset);
+
+  if (next != this->freeByOffset.begin())
+  {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset)
+    {
+      offset = previous->first;
+      size += previous->second;
+      this->eraseFree(previous);
+    }
+  }
+
+  if (next != this->freeByOffset.end() && offset + size == next->first)
+  {
+    size += next->second;
+    this->eraseFree(next);
+  }
+
+  this->insertFree(offset, size);
+}
+
+void RangeAllocator::grow(uint64_t capacity)
+{
+  if (capacity <= this->capacity) return;
+
+  uint64_t oldCapacity = this->capacity;
+  this->capacity = capacity;
+
+  // Freeing the new tail as if it had been allocated lets it coalesce with a trailing free block.
+  this->used += capacity - oldCapacity;
+  this->free(oldCapacity, capacity - oldCapacity);
+}
+
+void RangeAllocator::reset(uint64_t capacity, uint64_t used)
+{
+  this->capacity = capacity;
+  this->used = used;
+  this->freeByOffset.clear();
+  this->freeBySize.clear();
+
+  if (capacity > used) this->insertFree(used, capacity - used);
+}
+
+uint64_t RangeAllocator::getCapacity() const
+{
+  return this->capacity;
+}
+
+uint64_t RangeAllocator::getUsed() const
+{
+  return this->used;
+}
+
+uint64_t RangeAllocator::getLargestFreeBlock() const
+{
+  return this->freeBySize.empty() ? 0 : this->freeBySize.rbegin()->first;
+}
+
+uint32_t RangeAllocator::getFreeBlockCount() const
+{
+  return static_cast<uint32_t>(this->freeByOffset.size());
+}
+
+float RangeAllocator::getFragmentation() const
+{
+  uint64_t freeBytes = this->capacity - this->used;
+  if (freeBytes == 0) return 0.0f;
+
+  return 1.0f - static_cast<float>(this->getLargestFreeBlock()) / static_cast<float>(freeBytes);
+}
+
+void RangeAllocator::insertFree(uint64_t offset, uint64_t size)
+{
+  this->freeByOffset.emplace(offset, size);
+  this->freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<uint64_t, uint64_t>::iterator block)
+{
+  this->freeBySize.erase(std::make_pair(block->second, block->first));
+  this->freeByOffset.erase(block);
+}
@@ -0,0 +1,418 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GeometryHeap.h"
+#include "Hash.h"
+#include "UploadRing.h"
+
+namespace
+{
+  constexpr unsigned int PROGRAM_BITS = 10;
+  constexpr unsigned int MATERIAL_BITS = 16;
+  constexpr unsigned int FORMAT_BITS = 4;
+
+  // Non-negative floats compare the same as their bit patterns, so view depth can go straight into the key.
+  uint32_t depthBits(float depth)
+  {
+    depth = std::max(depth, 0.0f);
+
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+
+    return bits;
+  }
+
+  uint64_t makeKey(RenderPass pass, uint16_t program, uint16_t material, Model::VertexFormat format, float depth)
+  {
+    uint64_t key = static_cast<uint64_t>(pass) << 62;
+    uint64_t state = (static_cast<uint64_t>(program) << (MATERIAL_BITS + FORMAT_BITS)) |
+      (static_cast<uint64_t>(material) << FORMAT_BITS) |
+      static_cast<uint64_t>(format);
+
+    if (pass == RenderPass::Transparent)
+    {
+      // Farthest first; state only breaks ties between draws at the same depth.
+      key |= static_cast<uint64_t>(~depthBits(depth)) << (PROGRAM_BITS + MATERIAL_BITS + FORMAT_BITS);
+      key |= state;
+    }
+    else
+    {
+      key |= state << 32;
+      key |= depthBits(depth);
+    }
+
+    return key;
+  }
+}
+
+RenderQueue::RenderQueue():
+  view(1.0f),
+  transformTexture(0),
+  transformTextureBuffer(0),
+  overflowBuffer(0)
+{
+}
+
+void RenderQueue::begin(const glm::mat4& view)
+{
+  this->view = view;
+  this->transforms.clear();
+  this->items.clear();
+  this->counts.clear();
+  this->offsets.clear();
+  this->entries.clear();
+  this->stats = RenderQueueStats();
+}
+
+uint32_t RenderQueue::addTransform(const glm::mat4& transform)
+{
+  this->transforms.push_back(transform);
+
+  return static_cast<uint32_t>(this->transforms.size() - 1);
+}
+
+void RenderQueue::push(RenderPass pass, Shader& shader, const Model::Mesh& mesh, uint32_t transform, unsigned int level, const Model::MeshletCullContext* cull, Model::MeshletCullStats* cullStats)
+{
+  uint32_t firstRange = static_cast<uint32_t>(this->counts.size());
+  unsigned int rangeCount = mesh.appendDrawRanges(level, cull, cullStats, this->counts, this->offsets);
+  if (rangeCount == 0) return;
+
+  Item item;
+  item.shader = &shader;
+  item.mesh = &mesh;
+  item.transform = transform;
+  item.material = this->getMaterialId(mesh);
+  item.firstRange = firstRange;
+  item.rangeCount = rangeCount;
+
+  glm::vec4 center = this->view * this->transforms[transform] * glm::vec4(mesh.getCenter(), 1.0f);
+  uint64_t key = makeKey(pass, this->getProgramId(shader), item.material, mesh.getVertexFormat(), -center.z);
+
+  this->entries.push_back({ key, static_cast<uint32_t>(this->items.size()) });
+  this->items.push_back(item);
+}
+
+void RenderQueue::submit()
+{
+  this->stats.items = static_cast<unsigned int>(this->items.size());
+  if (this->items.empty()) return;
+
+  this->sort();
+
+  Model::GeometryHeap& heap = Model::GeometryHeap::shared();
+  // Other code may have bound its own VAO since the last submit.
+  heap.invalidateBinding();
+
+  Shader* program = nullptr;
+  uint32_t transform = ~0u;
+  uint32_t material = ~0u;
+  const Model::VertexQuantization* quantization = nullptr;
+  bool hasFormat = false;
+  Model::VertexFormat format = Model::VertexFormat::Float;
+  bool blending = false;
+
+  size_t next = 0;
+  while (next < this->entries.size())
+  {
+    const SortEntry& entry = this->entries[next];
+    const Item& item = this->items[entry.item];
+    const Model::Mesh& mesh = *item.mesh;
+
+    if (!blending && static_cast<RenderPass>(entry.key >> 62) == RenderPass::Transparent)
+    {
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      glDepthMask(GL_FALSE);
+      blending = true;
+    }
+
+    if (item.shader != program)
+    {
+      // Uniforms are per program, so everything below has to be set again.
+      program = item.shader;
+      program->use();
+      this->programUniforms.model = program->getUniform("model");
+      this->programUniforms.drawTransforms = program->getUniform("drawTransforms");
+      this->programUniforms.drawBase = program->getUniform("drawBase");
+      program->setInt(this->programUniforms.drawTransforms, DRAW_TRANSFORM_TEXTURE_UNIT);
+      transform = ~0u;
+      material = ~0u;
+      quantization = nullptr;
+      this->stats.programChanges++;
+    }
+
+    if (item.material != material)
+    {
+      material = item.material;
+      mesh.bindTextures(*program);
+      this->stats.materialChanges++;
+    }
+
+    if (this->programUniforms.drawTransforms.isValid())
+    {
+      // Batches bind the heap's instanced VAO, so the next unbatched item has to rebind its own.
+      next = this->submitBatch(next, *program);
+      hasFormat = false;
+      continue;
+    }
+
+    if (item.transform != transform)
+    {
+      transform = item.transform;
+      program->setMat4(this->programUniforms.model, this->transforms[transform]);
+    }
+
+    const Model::VertexQuantization& meshQuantization = mesh.getQuantization();
+    if (!quantization || quantization->offset != meshQuantization.offset || quantization->scale != meshQuantization.scale)
+    {
+      quantization = &meshQuantization;
+      mesh.bindQuantization(*program);
+    }
+
+    if (!hasFormat || mesh.getVertexFormat() != format)
+    {
+      hasFormat = true;
+      format = mesh.getVertexFormat();
+      heap.bind(format);
+      this->stats.vertexArrayChanges++;
+    }
+
+    GLint baseVertex = static_cast<GLint>(heap.getRange(mesh.getGeometry()).baseVertex);
+
+    if (item.rangeCount == 1)
+    {
+      glDrawElementsBaseVertex(GL_TRIANGLES, this->counts[item.firstRange], mesh.getIndexType(), this->offsets[item.firstRange], baseVertex);
+    }
+    else
+    {
+      this->baseVertices.assign(item.rangeCount, baseVertex);
+      glMultiDrawElementsBaseVertex(GL_TRIANGLES, &this->counts[item.firstRange], mesh.getIndexType(), &this->offsets[item.firstRange], static_cast<GLsizei>(item.rangeCount), this->baseVertices.data());
+    }
+
+    this->stats.drawCalls++;
+    next++;
+  }
+
+  if (blending)
+  {
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+  }
+}
+
+size_t RenderQueue::submitBatch(size_t first, Shader& program)
+{
+  Model::GeometryHeap& heap = Model::GeometryHeap::shared();
+  const Item& lead = this->items[this->entries[first].item];
+  Model::VertexFormat format = lead.mesh->getVertexFormat();
+  GLenum indexType = lead.mesh->getIndexType();
+  uint64_t pass = this->entries[first].key >> 62;
+  size_t stride = Model::indexSize(indexType);
+
+  this->batchTransforms.clear();
+  this->batchDrawIds.clear();
+  this->batchCommands.clear();
+
+  size_t end = first;
+  for (; end < this->entries.size(); end++)
+  {
+    const Item& item = this->items[this->entries[end].item];
+    const Model::Mesh& mesh = *item.mesh;
+
+    if (item.shader != lead.shader || item.material != lead.material || (this->entries[end].key >> 62) != pass ||
+      mesh.getVertexFormat() != format || mesh.getIndexType() != indexType) break;
+
+    // Folding the dequantization into the transform lets packed and float meshes share a batch.
+    const Model::VertexQuantization& quantization = mesh.getQuantization();
+    glm::mat4 decode = glm::scale(glm::translate(glm::mat4(1.0f), quantization.offset), quantization.scale);
+    GLuint drawId = static_cast<GLuint>(this->batchTransforms.size());
+
+    this->batchTransforms.push_back(this->transforms[item.transform] * decode);
+    this->batchDrawIds.push_back(drawId);
+
+    GLint baseVertex = static_cast<GLint>(heap.getRange(mesh.getGeometry()).baseVertex);
+    for (uint32_t range = item.firstRange; range < item.firstRange + item.rangeCount; range++)
+    {
+      DrawElementsIndirectCommand command;
+      command.count = static_cast<GLuint>(this->counts[range]);
+      command.instanceCount = 1;
+      command.firstIndex = static_cast<GLuint>(reinterpret_cast<uintptr_t>(this->offsets[range]) / stride);
+      command.baseVertex = baseVertex;
+      command.baseInstance = drawId;
+      this->batchCommands.push_back(command);
+    }
+  }
+
+  UploadRing& ring = UploadRing::shared();
+  UploadAllocation transforms = ring.upload(this->batchTransforms.data(), this->batchTransforms.size() * sizeof(glm::mat4), sizeof(glm::mat4));
+  UploadAllocation drawIds = ring.upload(this->batchDrawIds.data(), this->batchDrawIds.size() * sizeof(GLuint), sizeof(GLuint));
+  UploadAllocation commands = ring.upload(this->batchCommands.data(), this->batchCommands.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+
+  bool streamed = transforms.data && drawIds.data && commands.data;
+  GLuint transformBuffer;
+  int drawBase;
+
+  if (streamed)
+  {
+    ring.flush();
+    transformBuffer = ring.getBuffer();
+    drawBase = static_cast<int>(transforms.offset / sizeof(glm::mat4));
+  }
+  else
+  {
+    // The ring is full for this frame. Drawing the run is still better than dropping it, so its
+    // transforms are orphaned into the queue's own buffer and every command becomes its own call.
+    if (this->overflowBuffer == 0) glGenBuffers(1, &this->overflowBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->overflowBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(this->batchTransforms.size() * sizeof(glm::mat4)), this->batchTransforms.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    transformBuffer = this->overflowBuffer;
+    drawBase = 0;
+  }
+
+  glActiveTexture(GL_TEXTURE0 + DRAW_TRANSFORM_TEXTURE_UNIT);
+  if (this->transformTexture == 0) glGenTextures(1, &this->transformTexture);
+  glBindTexture(GL_TEXTURE_BUFFER, this->transformTexture);
+  if (this->transformTextureBuffer != transformBuffer)
+  {
+    // The texture views the whole ring (or the overflow buffer); drawBase skips to this batch's transforms.
+    this->transformTextureBuffer = transformBuffer;
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->transformTextureBuffer);
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  program.setInt(this->programUniforms.drawBase, drawBase);
+
+  const GLExtensions& extensions = GLExtensions::get();
+  GLsizei commandCount = static_cast<GLsizei>(this->batchCommands.size());
+
+  if (streamed && extensions.multiDrawIndirect)
+  {
+    heap.bindDrawIds(format, ring.getBuffer(), drawIds.offset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ring.getBuffer());
+    extensions.multiDrawElementsIndirect(GL_TRIANGLES, indexType, reinterpret_cast<const void*>(commands.offset), commandCount, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    this->stats.drawCalls++;
+  }
+  else
+  {
+    // GL 3.3 has no base instance and an overflowing run has no commands in a buffer, so the draw id
+    // goes in as the attribute's current value instead.
+    heap.bindDrawIds(format, 0, 0);
+    for (const DrawElementsIndirectCommand& command : this->batchCommands)
+    {
+      glVertexAttribI1ui(Model::DRAW_ID_LOCATION, command.baseInstance);
+      glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), indexType, reinterpret_cast<const void*>(static_cast<uintptr_t>(command.firstIndex) * stride), command.baseVertex);
+    }
+
+    this->stats.drawCalls += static_cast<unsigned int>(commandCount);
+  }
+
+  this->stats.vertexArrayChanges++;
+
+  if (streamed)
+  {
+    this->stats.batches++;
+    this->stats.batchedDraws += static_cast<unsigned int>(commandCount);
+  }
+  else
+  {
+    this->stats.overflowDraws += static_cast<unsigned int>(commandCount);
+  }
+
+  return end;
+}
+
+const RenderQueueStats& RenderQueue::getStats() const
+{
+  return this->stats;
+}
+
+void RenderQueue::shutdown()
+{
+  if (this->transformTexture != 0) glDeleteTextures(1, &this->transformTexture);
+  if (this->overflowBuffer != 0) glDeleteBuffers(1, &this->overflowBuffer);
+
+  this->transformTexture = 0;
+  this->transformTextureBuffer = 0;
+  this->overflowBuffer = 0;
+}
+
+uint16_t RenderQueue::getProgramId(const Shader& shader)
+{
+  auto found = this->programIds.find(shader.id);
+  if (found != this->programIds.end()) return found->second;
+
+  // Ids past the field width share the last value; submit() still compares the real state.
+  uint16_t id = static_cast<uint16_t>(std::min<size_t>(this->programIds.size(), (1u << PROGRAM_BITS) - 1));
+  this->programIds.emplace(shader.id, id);
+
+  return id;
+}
+
+uint16_t RenderQueue::getMaterialId(const Model::Mesh& mesh)
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (const Model::Texture& texture : mesh.textures)
+  {
+    hash = hashBytes(&texture.id, sizeof(texture.id), hash);
+    hash = hashBytes(texture.type.data(), texture.type.size(), hash);
+  }
+
+  auto found = this->materialIds.find(hash);
+  if (found != this->materialIds.end()) return found->second;
+
+  uint16_t id = static_cast<uint16_t>(std::min<size_t>(this->materialIds.size(), (1u << MATERIAL_BITS) - 1));
+  this->materialIds.emplace(hash, id);
+
+  return id;
+}
+
+void RenderQueue::sort()
+{
+  // LSD radix sort on byte digits. All eight histograms come from one pass over the keys, and a digit
+  // every key shares (a single pass, program or empty depth byte) costs nothing.
+  size_t count = this->entries.size();
+  this->scratch.resize(count);
+
+  uint32_t histograms[8][256] = {};
+  for (const SortEntry& entry : this->entries)
+  {
+    for (unsigned int digit = 0; digit < 8; digit++)
+    {
+      histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+    }
+  }
+
+  SortEntry* source = this->entries.data();
+  SortEntry* destination = this->scratch.data();
+
+  for (unsigned int digit = 0; digit < 8; digit++)
+  {
+    uint32_t* histogram = histograms[digit];
+    unsigned int shift = digit * 8;
+    if (histogram[(source[0].key >> shift) & 0xFF] == count) continue;
+
+    uint32_t offset = 0;
+    for (unsigned int bucket = 0; bucket < 256; bucket++)
+    {
+      uint32_t bucketCount = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += bucketCount;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+      destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+    }
+
+    std::swap(source, destination);
+    this->stats.sortPasses++;
+  }
+
+  if (source != this->entries.data()) this->entries.swap(this->scratch);
+}
@@ -2,37 +2,18 @@
 
 #include <glad/glad.h>
 
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <vector>
+
+#include "FrameConstants.h"
+#include "VirtualFileSystem.h"
 
 Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
 {
   std::string vertexShaderCode, fragmentShaderCode;
-  std::ifstream vShaderFile, fShaderFile;
-
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-  try
-  {
-    vShaderFile.open(vertexShaderPath);
-    fShaderFile.open(fragmentShaderPath);
-
-    std::stringstream vShaderStream, fShaderStream;
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
 
-    vShaderFile.close();
-    fShaderFile.close();
-
-    vertexShaderCode = vShaderStream.str();
-    fragmentShaderCode = fShaderStream.str();
-  }
-  catch (std::ifstream::failure& e)
-  {
-    std::cerr << "ERROR: Failed to read file: " << e.what() << std::endl;
-  }
+  readSource(vertexShaderPath, vertexShaderCode, 0);
+  readSource(fragmentShaderPath, fragmentShaderCode, 0);
 
   const char* vShaderCode = vertexShaderCode.c_str();
   const char* fShaderCode = fragmentShaderCode.c_str();
@@ -52,6 +33,11 @@ Shader::Shader(std::string vertexShaderPath, std::string fragmentShaderPath)
   glAttachShader(this->id, fragmentShader);
   glLinkProgram(this->id);
   this->checkCompileErrors(this->id, "PROGRAM");
+  this->reflectUniforms();
+
+  // GLSL 330 has no binding layout qualifier, so shared blocks are attached to their binding points here.
+  GLuint frameBlock = glGetUniformBlockIndex(this->id, FRAME_UNIFORM_BLOCK);
+  if (frameBlock != GL_INVALID_INDEX) glUniformBlockBinding(this->id, frameBlock, FRAME_UNIFORM_BINDING);
 
   glDeleteShader(vertexShader);
   glDeleteShader(fragmentShader);
@@ -62,49 +48,109 @@ void Shader::use()
   glUseProgram(this->id);;
 }
 
+UniformHandle Shader::getUniform(const std::string& name) const
+{
+  UniformHandle uniform;
+
+  auto found = this->uniforms.find(name);
+  if (found != this->uniforms.end()) uniform.location = found->second;
+
+  return uniform;
+}
+
+unsigned int Shader::getUniformCount() const
+{
+  return static_cast<unsigned int>(this->uniforms.size());
+}
+
+void Shader::setBool(UniformHandle uniform, bool value) const
+{
+  glUniform1i(uniform.location, static_cast<int>(value));
+}
+
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+  glUniform1i(uniform.location, value);
+}
+
+void Shader::setFloat(UniformHandle uniform, float value) const
+{
+  glUniform1f(uniform.location, value);
+}
+
+void Shader::setVec2(UniformHandle uniform, const glm::vec2& value) const
+{
+  glUniform2fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::setVec3(UniformHandle uniform, const glm::vec3& value) const
+{
+  glUniform3fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::setVec4(UniformHandle uniform, const glm::vec4& value) const
+{
+  glUniform4fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::setMat2(UniformHandle uniform, const glm::mat2& mat) const
+{
+  glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat3(UniformHandle uniform, const glm::mat3& mat) const
+{
+  glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& mat) const
+{
+  glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+
 void Shader::setBool(const std::string& name, bool value) const
 {
-  glUniform1i(glGetUniformLocation(this->id, name.c_str()), static_cast<int>(value));
+  this->setBool(this->getUniform(name), value);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-  glUniform1i(glGetUniformLocation(this->id, name.c_str()), (value));
+  this->setInt(this->getUniform(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const
 {
-  glUniform1f(glGetUniformLocation(this->id, name.c_str()), value);
+  this->setFloat(this->getUniform(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-  glUniform2fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
+  this->setVec2(this->getUniform(name), value);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-  glUniform3fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
+  this->setVec3(this->getUniform(name), value);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-  glUniform4fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
+  this->setVec4(this->getUniform(name), value);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-  glUniformMatrix2fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  this->setMat2(this->getUniform(name), mat);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-  glUniformMatrix3fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  this->setMat3(this->getUniform(name), mat);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-  glUniformMatrix4fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+  this->setMat4(this->getUniform(name), mat);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
@@ -137,4 +183,107 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
       std::cout << "The shader was linked successfully." << std::endl;
     }
   }
-}
\ No newline at end of file
+}
+
+void Shader::reflectUniforms()
+{
+  this->uniforms.clear();
+
+  GLint count = 0;
+  GLint maxLength = 0;
+  glGetProgramiv(this->id, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(this->id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  std::vector<char> buffer(static_cast<size_t>(maxLength) + 1);
+
+  for (GLint i = 0; i < count; i++)
+  {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(this->id, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+
+    std::string name(buffer.data(), static_cast<size_t>(length));
+
+    // Arrays are reported once as "name[0]"; every element gets its own entry so callers can index them.
+    size_t bracket = name.rfind("[0]");
+    if (bracket != std::string::npos && bracket + 3 == name.size())
+    {
+      std::string base = name.substr(0, bracket);
+
+      for (GLint element = 0; element < size; element++)
+      {
+        std::string elementName = base + "[" + std::to_string(element) + "]";
+        GLint location = glGetUniformLocation(this->id, elementName.c_str());
+        if (location >= 0) this->uniforms[elementName] = location;
+      }
+
+      auto first = this->uniforms.find(name);
+      if (first != this->uniforms.end()) this->uniforms[base] = first->second;
+    }
+    else
+    {
+      // Members of uniform blocks have no location and are set through their buffer instead.
+      GLint location = glGetUniformLocation(this->id, name.c_str());
+      if (location >= 0) this->uniforms[name] = location;
+    }
+  }
+}
+
+bool Shader::readSource(const std::string& path, std::string& source, unsigned int depth)
+{
+  if (depth > SHADER_INCLUDE_DEPTH)
+  {
+    std::cerr << "ERROR: Shader includes nested too deeply at: " << path << std::endl;
+    return false;
+  }
+
+  // Read through the asset file system so shaders resolve from the mounted pack like every other asset.
+  AssetFile file;
+  if (!file.open(path))
+  {
+    std::cerr << "ERROR: Failed to read file: " << path << std::endl;
+    return false;
+  }
+
+  std::string directory = path.substr(0, path.find_last_of('/') + 1);
+  const char* text = reinterpret_cast<const char*>(file.data());
+  size_t size = file.size();
+  size_t lineStart = 0;
+  bool success = true;
+
+  // Expands `#include "file"` lines, relative to the including file, before the source reaches GL.
+  while (lineStart < size)
+  {
+    size_t lineEnd = lineStart;
+    while (lineEnd < size && text[lineEnd] != '\n') lineEnd++;
+
+    std::string line(text + lineStart, lineEnd - lineStart);
+    size_t directive = line.find_first_not_of(" \t");
+
+    if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0)
+    {
+      size_t open = line.find('"', directive);
+      size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+
+      if (close == std::string::npos)
+      {
+        std::cerr << "ERROR: Malformed include in " << path << ": " << line << std::endl;
+        success = false;
+      }
+      else
+      {
+        success &= readSource(directory + line.substr(open + 1, close - open - 1), source, depth + 1);
+      }
+    }
+    else
+    {
+      source.append(line);
+    }
+
+    source.push_back('\n');
+    lineStart = lineEnd + 1;
+  }
+
+  return success;
+}
@@ -0,0 +1,165 @@
+#include "StartupProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// Captured during static initialisation so phases before main's first line are still counted.
+static const std::chrono::steady_clock::time_point processStart = std::chrono::steady_clock::now();
+
+StartupProfiler& StartupProfiler::shared()
+{
+  static StartupProfiler profiler;
+
+  return profiler;
+}
+
+StartupProfiler::StartupProfiler():
+  firstFrame(-1.0)
+{
+  // The first caller is main, so the main thread is always thread 0.
+  this->threads.push_back(std::this_thread::get_id());
+}
+
+double StartupProfiler::now() const
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - processStart).count();
+}
+
+unsigned int StartupProfiler::threadIndex(std::thread::id id)
+{
+  auto match = std::find(this->threads.begin(), this->threads.end(), id);
+  if (match != this->threads.end()) return static_cast<unsigned int>(match - this->threads.begin());
+
+  this->threads.push_back(id);
+
+  return static_cast<unsigned int>(this->threads.size() - 1);
+}
+
+void StartupProfiler::record(const std::string& name, double start, double end)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->events.push_back({ name, this->threadIndex(std::this_thread::get_id()), start, end });
+}
+
+void StartupProfiler::mark(const std::string& name)
+{
+  double time = this->now();
+
+  this->record(name, time, time);
+}
+
+void StartupProfiler::markFirstFrame()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->firstFrame >= 0.0) return;
+  }
+
+  double time = this->now();
+  this->record("First frame presented", time, time);
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->firstFrame = time;
+  }
+
+  this->printReport();
+  if (this->exportTrace(STARTUP_TRACE_PATH)) std::cout << "Startup trace written to " << STARTUP_TRACE_PATH << std::endl;
+}
+
+double StartupProfiler::getTimeToFirstFrame() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  return this->firstFrame;
+}
+
+void StartupProfiler::printReport() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::vector<StartupEvent> sorted = this->events;
+  std::stable_sort(sorted.begin(), sorted.end(), [](const StartupEvent& a, const StartupEvent& b) { return a.start < b.start; });
+
+  std::vector<double> busy(this->threads.size(), 0.0);
+  double serial = 0.0;
+  double wall = 0.0;
+
+  std::cout << "Startup report:" << std::endl;
+
+  for (const StartupEvent& event : sorted)
+  {
+    std::string label = event.thread == 0 ? "main" : "worker" + std::to_string(event.thread);
+    char line[96];
+    if (event.end > event.start)
+    {
+      std::snprintf(line, sizeof(line), "  %-8s %8.2f - %8.2f ms %8.2f ms  ", label.c_str(), event.start, event.end, event.end - event.start);
+    }
+    else
+    {
+      std::snprintf(line, sizeof(line), "  %-8s %8.2f ms %24s", label.c_str(), event.start, "");
+    }
+
+    std::cout << line << event.name << std::endl;
+
+    busy[event.thread] += event.end - event.start;
+    serial += event.end - event.start;
+    wall = std::max(wall, event.end);
+  }
+
+  // Nested phases are counted twice, so this is an upper bound on what running everything in a row would cost.
+  std::cout << "  main thread busy " << busy[0] << " ms, " << serial << " ms of phases finished in " << wall << " ms" << std::endl;
+
+  if (this->firstFrame >= 0.0) std::cout << "  time to first frame: " << this->firstFrame << " ms" << std::endl;
+}
+
+bool StartupProfiler::exportTrace(const std::string& path) const
+{
+  std::ofstream out(path, std::ios::trunc);
+  if (!out)
+  {
+    std::cerr << "Error: Unable to write startup trace " << path << std::endl;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  out << "{\"traceEvents\":[";
+
+  for (size_t i = 0; i < this->events.size(); i++)
+  {
+    const StartupEvent& event = this->events[i];
+    std::string name;
+    for (char c : event.name)
+    {
+      if (c == '"' || c == '\\') name += '\\';
+      name += c;
+    }
+
+    // Trace timestamps are in microseconds.
+    out << (i == 0 ? "" : ",") << "\n{\"name\":\"" << name << "\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start * 1000.0;
+    if (event.end > event.start) out << ",\"ph\":\"X\",\"dur\":" << (event.end - event.start) * 1000.0 << "}";
+    else out << ",\"ph\":\"i\",\"s\":\"g\"}";
+  }
+
+  out << "\n]}\n";
+
+  return static_cast<bool>(out);
+}
+
+StartupPhase::StartupPhase(std::string name):
+  name(std::move(name)),
+  start(StartupProfiler::shared().now())
+{
+}
+
+StartupPhase::~StartupPhase()
+{
+  StartupProfiler& profiler = StartupProfiler::shared();
+
+  profiler.record(this->name, this->start, profiler.now());
+}
@@ -1,6 +1,9 @@
 #include "Texture.h"
 
-#include "stb_image.h"
+#include "Hash.h"
+#include "TextureContainer.h"
+#include "TextureLoader.h"
+#include "VirtualFileSystem.h"
 #include <iostream>
 
 Texture::Texture():
@@ -11,23 +14,50 @@ Texture::Texture():
   wrapS(GL_REPEAT),
   wrapT(GL_REPEAT),
   filterMin(GL_LINEAR),
-  filterMax(GL_LINEAR)
+  filterMax(GL_LINEAR),
+  pending(false)
 {
   glGenTextures(1, &this->id);
 }
 
 Texture::Texture(std::string path): Texture()
 {
-  int width, height, nrChannels;
-  unsigned char* textureData = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+  AssetFile source;
+  TextureContainer cooked;
 
-  if (!textureData)
+  if (source.open(path) && cooked.open(TextureContainer::cookedPath(path)) &&
+    cooked.matchesSource(source.size(), hashBytes(source.data(), source.size())))
   {
-    std::cerr << "Error: Failed to load texture from: " << path << std::endl;
+    const TextureContainerHeader& header = cooked.getHeader();
+
+    this->width = header.width;
+    this->height = header.height;
+    this->internalFormat = header.internalFormat;
+    this->imageFormat = header.format;
+    if (header.levelCount > 1) this->filterMin = GL_LINEAR_MIPMAP_LINEAR;
+
+    TextureLoader::shared().uploadCooked(this->id, cooked);
+
+    glBindTexture(GL_TEXTURE_2D, this->id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, this->wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, this->wrapT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->filterMin);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->filterMax);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return;
   }
 
-  this->generate(width, height, textureData);
-  stbi_image_free(textureData);
+  // Set the sampler state now; the image itself is decoded and uploaded by the loader.
+  unsigned char placeholder[3] = { 255, 255, 255 };
+  this->generate(1, 1, placeholder);
+
+  TextureLoader::shared().loadInto(this->id, path, false);
+
+  // The placeholder's 1x1 RGB says nothing about the image; report nothing until it has arrived.
+  this->width = 0;
+  this->height = 0;
+  this->pending = true;
 }
 
 void Texture::generate(unsigned int width, unsigned int height, unsigned char* data)
@@ -54,4 +84,20 @@ void Texture::generate(unsigned int width, unsigned int height, unsigned char* d
 void Texture::bind() const
 {
   glBindTexture(GL_TEXTURE_2D, this->id);
-}
\ No newline at end of file
+}
+
+bool Texture::isLoaded()
+{
+  TextureImageInfo info;
+
+  if (this->pending && TextureLoader::shared().getImageInfo(this->id, info))
+  {
+    this->width = info.width;
+    this->height = info.height;
+    this->internalFormat = info.internalFormat;
+    this->imageFormat = info.format;
+    this->pending = false;
+  }
+
+  return !this->pending;
+}
@@ -0,0 +1,221 @@
+#include "TextureContainer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "Hash.h"
+
+constexpr uint64_t TEXTURE_CONTAINER_ALIGNMENT = 16;
+
+static uint64_t alignOffset(uint64_t offset)
+{
+  return (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) & ~(TEXTURE_CONTAINER_ALIGNMENT - 1);
+}
+
+// Bytes one level must hold: whole blocks for compressed formats, tightly packed rows
+// (uploadCooked sets GL_UNPACK_ALIGNMENT to 1) otherwise. 0 for a format the loader cannot upload.
+static uint64_t levelBytes(const TextureContainerHeader& header, uint32_t width, uint32_t height)
+{
+  BlockFormat blockFormat;
+  bool srgb;
+  if (TextureContainer::isCompressedFormat(header.internalFormat, blockFormat, srgb)) return compressedSize(width, height, blockFormat);
+
+  if (header.type != GL_UNSIGNED_BYTE) return 0;
+
+  uint64_t channels;
+  switch (header.format)
+  {
+  case GL_RED: channels = 1; break;
+  case GL_RG: channels = 2; break;
+  case GL_RGB: channels = 3; break;
+  case GL_RGBA: channels = 4; break;
+  default: return 0;
+  }
+
+  return static_cast<uint64_t>(width) * height * channels;
+}
+
+std::string TextureContainer::cookedPath(const std::string& sourcePath)
+{
+  return sourcePath + TEXTURE_CONTAINER_EXTENSION;
+}
+
+bool TextureContainer::write(const std::string& path, TextureContainerHeader header, const std::vector<TextureLevelData>& levels)
+{
+  std::memcpy(header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(header.magic));
+  header.version = TEXTURE_CONTAINER_VERSION;
+  if (header.faceCount == 0) header.faceCount = 1;
+  header.levelCount = static_cast<uint32_t>(levels.size() / header.faceCount);
+
+  std::vector<TextureContainerLevel> table(levels.size());
+  uint64_t offset = sizeof(TextureContainerHeader) + table.size() * sizeof(TextureContainerLevel);
+
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    offset = alignOffset(offset);
+    table[i].offset = offset;
+    table[i].size = levels[i].pixels.size();
+    table[i].width = levels[i].width;
+    table[i].height = levels[i].height;
+    offset += levels[i].pixels.size();
+  }
+
+  std::string tempPath = path + ".tmp";
+  std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+  if (!out)
+  {
+    std::cerr << "Error: Unable to write texture container " << tempPath << std::endl;
+    return false;
+  }
+
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(TextureContainerLevel)));
+
+  static const char zeros[TEXTURE_CONTAINER_ALIGNMENT] = {};
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    uint64_t position = static_cast<uint64_t>(out.tellp());
+    out.write(zeros, static_cast<std::streamsize>(table[i].offset - position));
+    out.write(reinterpret_cast<const char*>(levels[i].pixels.data()), static_cast<std::streamsize>(levels[i].pixels.size()));
+  }
+
+  out.close();
+
+  if (!out || std::rename(tempPath.c_str(), path.c_str()) != 0)
+  {
+    std::cerr << "Error: Unable to write texture container " << path << std::endl;
+    std::remove(tempPath.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool TextureContainer::fingerprintCubemap(const std::vector<std::string>& facePaths, uint64_t& sourceSize, uint64_t& sourceHash)
+{
+  sourceSize = 0;
+  sourceHash = FNV_OFFSET_BASIS;
+
+  for (const std::string& facePath : facePaths)
+  {
+    AssetFile face;
+    if (!face.open(facePath)) return false;
+
+    uint64_t faceHash = hashBytes(face.data(), face.size());
+    sourceSize += face.size();
+    sourceHash = hashBytes(&faceHash, sizeof(faceHash), sourceHash);
+  }
+
+  return true;
+}
+
+bool TextureContainer::open(const std::string& path, AssetLookup lookup)
+{
+  this->levels = nullptr;
+
+  if (!this->file.open(path, lookup)) return false;
+
+  const unsigned char* data = this->file.data();
+  uint64_t size = this->file.size();
+
+  if (size < sizeof(TextureContainerHeader)) return false;
+  std::memcpy(&this->header, data, sizeof(this->header));
+
+  uint64_t tableEntries = static_cast<uint64_t>(this->header.levelCount) * this->header.faceCount;
+
+  if (std::memcmp(this->header.magic, TEXTURE_CONTAINER_MAGIC, sizeof(this->header.magic)) != 0 ||
+    this->header.version != TEXTURE_CONTAINER_VERSION ||
+    this->header.levelCount == 0 ||
+    (this->header.faceCount != 1 && this->header.faceCount != CUBEMAP_FACE_COUNT) ||
+    size < sizeof(TextureContainerHeader) + tableEntries * sizeof(TextureContainerLevel))
+  {
+    return false;
+  }
+
+  // texStorage2D allocates the chain from the header, so it must not have more levels than the base size allows.
+  uint32_t maxLevels = 1;
+  for (uint32_t extent = std::max(this->header.width, this->header.height); extent > 1; extent >>= 1) maxLevels++;
+
+  if (this->header.width == 0 || this->header.height == 0 || this->header.levelCount > maxLevels)
+  {
+    std::cerr << "Error: Texture container " << path << " has an invalid size" << std::endl;
+    return false;
+  }
+
+  // Every level is checked here so uploadCooked can hand its bytes to GL without reading past the mapping.
+  uint64_t dataStart = sizeof(TextureContainerHeader) + tableEntries * sizeof(TextureContainerLevel);
+  const TextureContainerLevel* table = reinterpret_cast<const TextureContainerLevel*>(data + sizeof(TextureContainerHeader));
+  for (uint64_t i = 0; i < tableEntries; i++)
+  {
+    const TextureContainerLevel& level = table[i];
+    uint32_t mipLevel = static_cast<uint32_t>(i / this->header.faceCount);
+
+    if (level.offset < dataStart || level.offset > size || level.size > size - level.offset)
+    {
+      std::cerr << "Error: Texture container " << path << " is truncated" << std::endl;
+      return false;
+    }
+
+    uint64_t expected = levelBytes(this->header, level.width, level.height);
+
+    if (level.width != std::max(this->header.width >> mipLevel, 1u) || level.height != std::max(this->header.height >> mipLevel, 1u) ||
+      expected == 0 || level.size != expected)
+    {
+      std::cerr << "Error: Texture container " << path << " has an invalid level " << mipLevel << std::endl;
+      return false;
+    }
+  }
+
+  this->levels = table;
+
+  return true;
+}
+
+bool TextureContainer::matchesSource(uint64_t sourceSize, uint64_t sourceHash) const
+{
+  return this->levels && this->header.sourceSize == sourceSize && this->header.sourceHash == sourceHash;
+}
+
+const TextureContainerHeader& TextureContainer::getHeader() const
+{
+  return this->header;
+}
+
+size_t TextureContainer::getDataSize() const
+{
+  size_t size = 0;
+  for (uint32_t i = 0; this->levels && i < this->header.levelCount * this->header.faceCount; i++)
+  {
+    size += this->levels[i].size;
+  }
+
+  return size;
+}
+
+bool TextureContainer::isCompressedFormat(unsigned int internalFormat, BlockFormat& format, bool& srgb)
+{
+  switch (internalFormat)
+  {
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: format = BlockFormat::BC1; srgb = false; return true;
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: format = BlockFormat::BC1; srgb = true; return true;
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: format = BlockFormat::BC3; srgb = false; return true;
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: format = BlockFormat::BC3; srgb = true; return true;
+  case GL_COMPRESSED_RGBA_BPTC_UNORM: format = BlockFormat::BC7; srgb = false; return true;
+  case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM: format = BlockFormat::BC7; srgb = true; return true;
+  default: return false;
+  }
+}
+
+const TextureContainerLevel& TextureContainer::getLevel(unsigned int level, unsigned int face) const
+{
+  return this->levels[level * this->header.faceCount + face];
+}
+
+const unsigned char* TextureContainer::getLevelData(unsigned int level, unsigned int face) const
+{
+  return this->file.data() + this->getLevel(level, face).offset;
+}
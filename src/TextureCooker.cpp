@@ -0,0 +1,233 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "stb_image.h"
+
+static float srgbToLinear(unsigned char value)
+{
+  float c = value / 255.0f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static unsigned char linearToSrgb(float value)
+{
+  float c = std::clamp(value, 0.0f, 1.0f);
+  c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+
+  return static_cast<unsigned char>(std::lround(c * 255.0f));
+}
+
+std::vector<TextureLevelData> buildMipChain(const unsigned char* pixels, unsigned int width, unsigned int height, unsigned int channels, bool generateMipmaps)
+{
+  float toLinear[256];
+  for (int i = 0; i < 256; i++)
+  {
+    toLinear[i] = srgbToLinear(static_cast<unsigned char>(i));
+  }
+
+  std::vector<TextureLevelData> levels;
+
+  TextureLevelData base;
+  base.width = width;
+  base.height = height;
+  base.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * channels);
+  levels.push_back(std::move(base));
+
+  while (generateMipmaps && (levels.back().width > 1 || levels.back().height > 1))
+  {
+    const TextureLevelData& source = levels.back();
+
+    TextureLevelData level;
+    level.width = std::max(1u, source.width / 2);
+    level.height = std::max(1u, source.height / 2);
+    level.pixels.resize(static_cast<size_t>(level.width) * level.height * channels);
+
+    for (unsigned int y = 0; y < level.height; y++)
+    {
+      unsigned int y0 = std::min(2 * y, source.height - 1);
+      unsigned int y1 = std::min(2 * y + 1, source.height - 1);
+
+      for (unsigned int x = 0; x < level.width; x++)
+      {
+        unsigned int x0 = std::min(2 * x, source.width - 1);
+        unsigned int x1 = std::min(2 * x + 1, source.width - 1);
+
+        const unsigned char* taps[4] = {
+          &source.pixels[(static_cast<size_t>(y0) * source.width + x0) * channels],
+          &source.pixels[(static_cast<size_t>(y0) * source.width + x1) * channels],
+          &source.pixels[(static_cast<size_t>(y1) * source.width + x0) * channels],
+          &source.pixels[(static_cast<size_t>(y1) * source.width + x1) * channels]
+        };
+
+        unsigned char* out = &level.pixels[(static_cast<size_t>(y) * level.width + x) * channels];
+
+        for (unsigned int c = 0; c < channels; c++)
+        {
+          // Alpha is coverage, not colour, so it is averaged as stored.
+          if (c == 3)
+          {
+            out[c] = static_cast<unsigned char>((taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) / 4);
+            continue;
+          }
+
+          float sum = toLinear[taps[0][c]] + toLinear[taps[1][c]] + toLinear[taps[2][c]] + toLinear[taps[3][c]];
+          out[c] = linearToSrgb(sum * 0.25f);
+        }
+      }
+    }
+
+    levels.push_back(std::move(level));
+  }
+
+  return levels;
+}
+
+// Decodes one image and produces its finished levels plus the format fields of the header.
+static bool cookLevels(const std::string& sourcePath, const TextureCookOptions& options, std::vector<TextureLevelData>& levels, TextureContainerHeader& header)
+{
+  MappedFile source;
+  if (!source.open(sourcePath))
+  {
+    std::cerr << "Error: Unable to open " << sourcePath << std::endl;
+    return false;
+  }
+
+  int width, height, channels;
+  if (!stbi_info_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels))
+  {
+    std::cerr << "Error: Unsupported image " << sourcePath << ": " << stbi_failure_reason() << std::endl;
+    return false;
+  }
+
+  // Grey images are widened to RGB(A) so they sample the same as they did through stb_image + GL_RGB.
+  // The block encoders always read RGBA.
+  int storedChannels = options.compress || channels == 2 || channels == 4 ? 4 : 3;
+  unsigned char* pixels = stbi_load_from_memory(source.data(), static_cast<int>(source.size()), &width, &height, &channels, storedChannels);
+  if (!pixels)
+  {
+    std::cerr << "Error: Failed to decode " << sourcePath << ": " << stbi_failure_reason() << std::endl;
+    return false;
+  }
+
+  levels = buildMipChain(pixels, width, height, storedChannels, options.generateMipmaps);
+  stbi_image_free(pixels);
+
+  header.width = width;
+  header.height = height;
+  header.format = storedChannels == 4 ? GL_RGBA : GL_RGB;
+  header.type = GL_UNSIGNED_BYTE;
+  header.sourceSize = source.size();
+  header.sourceHash = hashBytes(source.data(), source.size());
+
+  if (options.srgb)
+  {
+    header.internalFormat = storedChannels == 4 ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+  }
+  else
+  {
+    header.internalFormat = storedChannels == 4 ? GL_RGBA8 : GL_RGB8;
+  }
+
+  if (options.compress)
+  {
+    for (TextureLevelData& level : levels)
+    {
+      level.pixels = compressImage(level.pixels.data(), level.width, level.height, options.blockFormat);
+    }
+
+    header.format = 0;
+    header.type = 0;
+
+    switch (options.blockFormat)
+    {
+    case BlockFormat::BC1:
+      header.internalFormat = options.srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      break;
+    case BlockFormat::BC3:
+      header.internalFormat = options.srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+      break;
+    case BlockFormat::BC7:
+      header.internalFormat = options.srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+      break;
+    }
+  }
+
+  return true;
+}
+
+bool cookTexture(const std::string& sourcePath, const std::string& outputPath, const TextureCookOptions& options)
+{
+  std::vector<TextureLevelData> levels;
+  TextureContainerHeader header = {};
+  header.faceCount = 1;
+
+  if (!cookLevels(sourcePath, options, levels, header)) return false;
+
+  return TextureContainer::write(outputPath, header, levels);
+}
+
+TextureCookOptions cookOptionsFor(const TextureContainerHeader& header)
+{
+  TextureCookOptions options = {};
+  options.generateMipmaps = header.levelCount > 1;
+  options.compress = TextureContainer::isCompressedFormat(header.internalFormat, options.blockFormat, options.srgb);
+
+  if (!options.compress)
+  {
+    options.srgb = header.internalFormat == GL_SRGB8 || header.internalFormat == GL_SRGB8_ALPHA8;
+  }
+
+  return options;
+}
+
+bool cookCubemap(const std::vector<std::string>& facePaths, const std::string& outputPath, const TextureCookOptions& options)
+{
+  if (facePaths.size() != CUBEMAP_FACE_COUNT)
+  {
+    std::cerr << "Error: A cube map needs exactly " << CUBEMAP_FACE_COUNT << " faces" << std::endl;
+    return false;
+  }
+
+  std::vector<std::vector<TextureLevelData>> faces(CUBEMAP_FACE_COUNT);
+  TextureContainerHeader header = {};
+  uint64_t sourceHash = FNV_OFFSET_BASIS;
+  uint64_t sourceSize = 0;
+
+  for (unsigned int face = 0; face < CUBEMAP_FACE_COUNT; face++)
+  {
+    TextureContainerHeader faceHeader = {};
+    if (!cookLevels(facePaths[face], options, faces[face], faceHeader)) return false;
+
+    if (face > 0 && (faceHeader.width != header.width || faceHeader.height != header.height || faceHeader.internalFormat != header.internalFormat))
+    {
+      std::cerr << "Error: Cube map face " << facePaths[face] << " does not match the size and format of the first face" << std::endl;
+      return false;
+    }
+
+    header = faceHeader;
+    sourceSize += faceHeader.sourceSize;
+    sourceHash = hashBytes(&faceHeader.sourceHash, sizeof(faceHeader.sourceHash), sourceHash);
+  }
+
+  header.faceCount = CUBEMAP_FACE_COUNT;
+  header.sourceSize = sourceSize;
+  header.sourceHash = sourceHash;
+
+  // Containers store levels level-major: every face of level 0, then every face of level 1, ...
+  std::vector<TextureLevelData> levels;
+  for (size_t level = 0; level < faces[0].size(); level++)
+  {
+    for (unsigned int face = 0; face < CUBEMAP_FACE_COUNT; face++)
+    {
+      levels.push_back(std::move(faces[face][level]));
+    }
+  }
+
+  return TextureContainer::write(outputPath, header, levels);
+}
@@ -0,0 +1,512 @@
+#include "TextureLoader.h"
+
+#include <cstring>
+#include <future>
+#include <iostream>
+
+#include "GLExtensions.h"
+#include "stb_image.h"
+#include "ThreadPool.h"
+#include "VirtualFileSystem.h"
+
+// Decodes from the mapped asset bytes, so images inside the pack need no extra file open or read copy.
+static unsigned char* decodeImage(const std::string& path, int* width, int* height, int* channels, int desiredChannels)
+{
+  AssetFile file;
+  if (!file.open(path)) return nullptr;
+
+  return stbi_load_from_memory(file.data(), static_cast<int>(file.size()), width, height, channels, desiredChannels);
+}
+
+static GLenum formatFromChannels(int channels)
+{
+  switch (channels)
+  {
+  case 1: return GL_RED;
+  case 2: return GL_RG;
+  case 4: return GL_RGBA;
+  default: return GL_RGB;
+  }
+}
+
+TextureLoader& TextureLoader::shared()
+{
+  static TextureLoader loader;
+  return loader;
+}
+
+TextureLoader::TextureLoader():
+  nextBuffer(0),
+  totalMemory({ 0, 0 }),
+  decoding(0),
+  nextJob(0)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+  // Decode tasks push into this object, so wait for them before it goes away.
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->decodeFinished.wait(lock, [this]() { return this->decoding == 0; });
+
+  for (DecodedImage& image : this->decoded)
+  {
+    stbi_image_free(image.pixels);
+  }
+}
+
+unsigned int TextureLoader::load(const std::string& path, bool generateMipmaps)
+{
+  unsigned int textureId;
+  glGenTextures(1, &textureId);
+
+  glBindTexture(GL_TEXTURE_2D, textureId);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generateMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  this->loadInto(textureId, path, generateMipmaps);
+
+  return textureId;
+}
+
+void TextureLoader::loadInto(unsigned int textureId, const std::string& path, bool generateMipmaps)
+{
+  // A single white texel is a complete mip chain, so the texture is sampleable straight away.
+  const unsigned char placeholder[4] = { 255, 255, 255, 255 };
+
+  glBindTexture(GL_TEXTURE_2D, textureId);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  uint64_t job;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->decoding++;
+    job = ++this->nextJob;
+    this->pendingJobs[textureId] = job;
+  }
+
+  ThreadPool::shared().submit([this, textureId, job, path, generateMipmaps]()
+  {
+    DecodedImage image;
+    image.textureId = textureId;
+    image.job = job;
+    image.path = path;
+    image.generateMipmaps = generateMipmaps;
+    image.pixels = decodeImage(path, &image.width, &image.height, &image.channels, 0);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (image.pixels)
+    {
+      this->decoded.push_back(image);
+    }
+    else
+    {
+      std::cerr << "Error: Failed to load texture from: " << path << std::endl;
+
+      auto pending = this->pendingJobs.find(textureId);
+      if (pending != this->pendingJobs.end() && pending->second == job) this->pendingJobs.erase(pending);
+    }
+
+    this->decoding--;
+    this->decodeFinished.notify_all();
+  });
+}
+
+unsigned int TextureLoader::loadCooked(const TextureContainer& container)
+{
+  unsigned int textureId;
+  glGenTextures(1, &textureId);
+
+  this->uploadCooked(textureId, container);
+
+  glBindTexture(GL_TEXTURE_2D, textureId);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, container.getHeader().levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return textureId;
+}
+
+void TextureLoader::uploadCooked(unsigned int textureId, const TextureContainer& container)
+{
+  const TextureContainerHeader& header = container.getHeader();
+
+  BlockFormat blockFormat;
+  bool srgb;
+  bool compressed = TextureContainer::isCompressedFormat(header.internalFormat, blockFormat, srgb);
+  bool decode = compressed && !GLExtensions::get().supportsCompressedFormat(header.internalFormat);
+
+  GLenum target = header.faceCount == CUBEMAP_FACE_COUNT ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+  GLenum internalFormat = decode ? (srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8) : header.internalFormat;
+
+  glBindTexture(target, textureId);
+
+  // Immutable storage allocates the whole chain once and lets the driver skip completeness checks.
+  const GLExtensions& extensions = GLExtensions::get();
+  bool immutable = extensions.textureStorage;
+  if (immutable)
+  {
+    extensions.texStorage2D(target, header.levelCount, internalFormat, header.width, header.height);
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  TextureMemory memory = { 0, 0 };
+
+  for (unsigned int mipLevel = 0; mipLevel < header.levelCount; mipLevel++)
+  {
+    for (unsigned int face = 0; face < header.faceCount; face++)
+    {
+      const TextureContainerLevel& level = container.getLevel(mipLevel, face);
+      const unsigned char* pixels = container.getLevelData(mipLevel, face);
+      GLenum imageTarget = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+      memory.uncompressedBytes += static_cast<size_t>(level.width) * level.height * 4;
+
+      if (compressed && !decode)
+      {
+        if (immutable)
+        {
+          glCompressedTexSubImage2D(imageTarget, mipLevel, 0, 0, level.width, level.height, internalFormat, static_cast<GLsizei>(level.size), pixels);
+        }
+        else
+        {
+          glCompressedTexImage2D(imageTarget, mipLevel, internalFormat, level.width, level.height, 0, static_cast<GLsizei>(level.size), pixels);
+        }
+
+        memory.residentBytes += level.size;
+        continue;
+      }
+
+      std::vector<unsigned char> decoded;
+      GLenum format = header.format;
+      GLenum type = header.type;
+
+      if (decode)
+      {
+        decoded = decompressImage(pixels, level.width, level.height, blockFormat);
+        pixels = decoded.data();
+        format = GL_RGBA;
+        type = GL_UNSIGNED_BYTE;
+      }
+
+      if (immutable)
+      {
+        glTexSubImage2D(imageTarget, mipLevel, 0, 0, level.width, level.height, format, type, pixels);
+      }
+      else
+      {
+        glTexImage2D(imageTarget, mipLevel, internalFormat, level.width, level.height, 0, format, type, pixels);
+      }
+
+      memory.residentBytes += static_cast<size_t>(level.width) * level.height * 4;
+    }
+  }
+
+  glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(target, 0);
+
+  this->track(textureId, memory);
+}
+
+unsigned int TextureLoader::loadCubemap(const std::vector<std::string>& faces)
+{
+  PendingCubemap pending = decodeCubemap(faces);
+
+  return this->uploadCubemap(pending);
+}
+
+PendingCubemap TextureLoader::decodeCubemap(const std::vector<std::string>& faces)
+{
+  PendingCubemap pending;
+  pending.faces = faces;
+
+  for (const std::string& path : faces)
+  {
+    pending.decodes.push_back(ThreadPool::shared().submit([path]()
+    {
+      PendingCubemap::Face face;
+      face.pixels = decodeImage(path, &face.width, &face.height, &face.channels, 3);
+      return face;
+    }));
+  }
+
+  return pending;
+}
+
+unsigned int TextureLoader::uploadCubemap(PendingCubemap& pending)
+{
+  unsigned int textureId;
+  glGenTextures(1, &textureId);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  const GLExtensions& extensions = GLExtensions::get();
+  int width = 0, height = 0;
+  TextureMemory memory = { 0, 0 };
+
+  // Faces are uploaded in order as soon as each decode finishes, overlapping with the later ones.
+  for (unsigned int i = 0; i < pending.decodes.size(); i++)
+  {
+    PendingCubemap::Face face = pending.decodes[i].get();
+
+    if (!face.pixels)
+    {
+      std::cerr << "Failed to load skybox face " << pending.faces[i] << std::endl;
+      continue;
+    }
+
+    if (width == 0)
+    {
+      width = face.width;
+      height = face.height;
+
+      if (extensions.textureStorage) extensions.texStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGB8, width, height);
+    }
+
+    if (face.width != width || face.height != height)
+    {
+      std::cerr << "Error: Skybox face " << pending.faces[i] << " does not match the size of the first face" << std::endl;
+    }
+    else if (extensions.textureStorage)
+    {
+      glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, face.pixels);
+    }
+    else
+    {
+      glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, face.pixels);
+    }
+
+    memory.residentBytes += static_cast<size_t>(face.width) * face.height * 4;
+    stbi_image_free(face.pixels);
+  }
+
+  memory.uncompressedBytes = memory.residentBytes;
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  this->track(textureId, memory);
+
+  return textureId;
+}
+
+unsigned int TextureLoader::loadCookedCubemap(const std::string& path, uint64_t sourceSize, uint64_t sourceHash)
+{
+  // Recooked at runtime when the faces change, so the loose copy must win over the pack.
+  TextureContainer container;
+  if (!container.open(path, AssetLookup::LooseFirst) || container.getHeader().faceCount != CUBEMAP_FACE_COUNT ||
+    !container.matchesSource(sourceSize, sourceHash))
+  {
+    return 0;
+  }
+
+  unsigned int textureId;
+  glGenTextures(1, &textureId);
+
+  this->uploadCooked(textureId, container);
+
+  glBindTexture(GL_TEXTURE_CUBE_MAP, textureId);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, container.getHeader().levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  return textureId;
+}
+
+void TextureLoader::forget(unsigned int textureId)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pendingJobs.erase(textureId);
+  }
+
+  this->track(textureId, { 0, 0 });
+  this->textureMemory.erase(textureId);
+  this->imageInfo.erase(textureId);
+}
+
+TextureMemory TextureLoader::getMemory() const
+{
+  return this->totalMemory;
+}
+
+bool TextureLoader::getImageInfo(unsigned int textureId, TextureImageInfo& info) const
+{
+  auto match = this->imageInfo.find(textureId);
+  if (match == this->imageInfo.end()) return false;
+
+  info = match->second;
+
+  return true;
+}
+
+void TextureLoader::track(unsigned int textureId, TextureMemory memory)
+{
+  TextureMemory& previous = this->textureMemory[textureId];
+
+  this->totalMemory.residentBytes += memory.residentBytes - previous.residentBytes;
+  this->totalMemory.uncompressedBytes += memory.uncompressedBytes - previous.uncompressedBytes;
+
+  previous = memory;
+}
+
+void TextureLoader::update(size_t byteBudget)
+{
+  size_t uploadedBytes = 0;
+
+  while (true)
+  {
+    DecodedImage image;
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (this->decoded.empty()) return;
+
+      size_t size = static_cast<size_t>(this->decoded.front().width) * this->decoded.front().height * this->decoded.front().channels;
+
+      // Always make progress on at least one image, even if it alone exceeds the budget.
+      if (uploadedBytes > 0 && uploadedBytes + size > byteBudget) return;
+
+      image = this->decoded.front();
+      this->decoded.pop_front();
+
+      // The texture was forgotten (and maybe its id reused) while this image was decoding.
+      auto job = this->pendingJobs.find(image.textureId);
+      if (job == this->pendingJobs.end() || job->second != image.job)
+      {
+        stbi_image_free(image.pixels);
+        continue;
+      }
+
+      uploadedBytes += size;
+    }
+
+    PixelBuffer* buffer = this->acquireBuffer();
+    if (!buffer)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->decoded.push_front(image);
+      return;
+    }
+
+    this->upload(image, *buffer);
+    stbi_image_free(image.pixels);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pendingJobs.erase(image.textureId);
+  }
+}
+
+void TextureLoader::finish()
+{
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->decodeFinished.wait(lock, [this]() { return this->decoding == 0; });
+  }
+
+  while (!this->isIdle())
+  {
+    this->update(static_cast<size_t>(-1));
+  }
+}
+
+bool TextureLoader::isIdle()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->decoding == 0 && this->decoded.empty();
+}
+
+TextureLoader::PixelBuffer* TextureLoader::acquireBuffer()
+{
+  if (this->ring.empty())
+  {
+    this->ring.resize(PIXEL_BUFFER_RING_SIZE);
+
+    for (PixelBuffer& buffer : this->ring)
+    {
+      glGenBuffers(1, &buffer.id);
+      buffer.capacity = 0;
+      buffer.fence = nullptr;
+    }
+  }
+
+  PixelBuffer& buffer = this->ring[this->nextBuffer];
+
+  // The buffer is still being read by an earlier upload; try again next frame instead of stalling.
+  if (buffer.fence)
+  {
+    if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return nullptr;
+
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+  }
+
+  this->nextBuffer = (this->nextBuffer + 1) % PIXEL_BUFFER_RING_SIZE;
+
+  return &buffer;
+}
+
+void TextureLoader::upload(const DecodedImage& image, PixelBuffer& buffer)
+{
+  size_t size = static_cast<size_t>(image.width) * image.height * image.channels;
+  GLenum format = formatFromChannels(image.channels);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+
+  if (buffer.capacity < size)
+  {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    buffer.capacity = size;
+  }
+
+  void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+  if (!mapped)
+  {
+    std::cerr << "Error: Unable to map pixel buffer for " << image.path << std::endl;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+
+  std::memcpy(mapped, image.pixels, size);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glBindTexture(GL_TEXTURE_2D, image.textureId);
+  glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+
+  if (image.generateMipmaps) glGenerateMipmap(GL_TEXTURE_2D);
+
+  // Drivers store 8-bit RGB as RGBA, so every texel is counted as four bytes.
+  size_t levelBytes = static_cast<size_t>(image.width) * image.height * 4;
+  size_t chainBytes = image.generateMipmaps ? levelBytes + levelBytes / 3 : levelBytes;
+  this->track(image.textureId, { chainBytes, chainBytes });
+  this->imageInfo[image.textureId] = { static_cast<unsigned int>(image.width), static_cast<unsigned int>(image.height), format, format };
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,149 @@
+#include "TextureRegistry.h"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+
+#include "Hash.h"
+#include "TextureContainer.h"
+#include "TextureLoader.h"
+#include "VirtualFileSystem.h"
+
+TextureResource::TextureResource(unsigned int id, std::string path, uint64_t contentHash):
+  id(id),
+  path(std::move(path)),
+  contentHash(contentHash)
+{
+}
+
+TextureResource::~TextureResource()
+{
+  TextureRegistry::shared().release(*this);
+}
+
+TextureRegistry& TextureRegistry::shared()
+{
+  static TextureRegistry registry;
+  return registry;
+}
+
+TextureRegistry::TextureRegistry():
+  liveTextures(0),
+  contextAlive(true)
+{
+}
+
+TextureSource TextureRegistry::describe(const std::string& path)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->describeMutex);
+
+    auto match = this->described.find(path);
+    if (match != this->described.end()) return match->second;
+  }
+
+  TextureSource source;
+  std::error_code error;
+  source.path = std::filesystem::weakly_canonical(path, error).string();
+  if (error) source.path = path;
+  source.size = 0;
+  source.contentHash = 0;
+
+  AssetFile file;
+  if (file.open(source.path))
+  {
+    source.size = file.size();
+    source.contentHash = hashBytes(file.data(), file.size());
+  }
+
+  std::lock_guard<std::mutex> lock(this->describeMutex);
+  this->described.emplace(path, source);
+
+  return source;
+}
+
+TextureHandle TextureRegistry::acquire(const std::string& path, bool generateMipmaps)
+{
+  return this->acquire(this->describe(path), generateMipmaps);
+}
+
+TextureHandle TextureRegistry::acquire(const TextureSource& source, bool generateMipmaps)
+{
+  auto pathMatch = this->byPath.find(source.path);
+  if (pathMatch != this->byPath.end())
+  {
+    if (TextureHandle texture = pathMatch->second.lock()) return texture;
+  }
+
+  // A new path may still be a copy of an image that is already resident.
+  if (source.contentHash != 0)
+  {
+    auto contentMatch = this->byContent.find(source.contentHash);
+    if (contentMatch != this->byContent.end())
+    {
+      if (TextureHandle texture = contentMatch->second.lock())
+      {
+        this->byPath[source.path] = texture;
+        texture->aliases.push_back(source.path);
+        return texture;
+      }
+    }
+  }
+
+  unsigned int id;
+  TextureContainer cooked;
+
+  if (source.contentHash != 0 && cooked.open(TextureContainer::cookedPath(source.path)) && cooked.matchesSource(source.size, source.contentHash))
+  {
+    id = TextureLoader::shared().loadCooked(cooked);
+  }
+  else
+  {
+    id = TextureLoader::shared().load(source.path, generateMipmaps);
+  }
+
+  TextureHandle texture = std::make_shared<TextureResource>(id, source.path, source.contentHash);
+  texture->aliases.push_back(source.path);
+
+  this->byPath[source.path] = texture;
+  if (source.contentHash != 0) this->byContent[source.contentHash] = texture;
+  this->liveTextures++;
+
+  return texture;
+}
+
+void TextureRegistry::shutdown()
+{
+  this->contextAlive = false;
+}
+
+bool TextureRegistry::hasContext() const
+{
+  return this->contextAlive;
+}
+
+size_t TextureRegistry::textureCount() const
+{
+  return this->liveTextures;
+}
+
+void TextureRegistry::release(const TextureResource& texture)
+{
+  // Drop the texture's path aliases and its content entry, unless a live texture took them over.
+  for (const std::string& alias : texture.aliases)
+  {
+    auto pathMatch = this->byPath.find(alias);
+    if (pathMatch != this->byPath.end() && pathMatch->second.expired()) this->byPath.erase(pathMatch);
+  }
+
+  auto contentMatch = this->byContent.find(texture.contentHash);
+  if (contentMatch != this->byContent.end() && contentMatch->second.expired())
+  {
+    this->byContent.erase(contentMatch);
+  }
+
+  this->liveTextures--;
+  TextureLoader::shared().forget(texture.id);
+
+  if (this->contextAlive) glDeleteTextures(1, &texture.id);
+}
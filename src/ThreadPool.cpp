@@ -0,0 +1,58 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int numThreads):
+  stopping(false)
+{
+  if (numThreads == 0) numThreads = 1;
+
+  for (unsigned int i = 0; i < numThreads; i++)
+  {
+    this->workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+
+  this->condition.notify_all();
+
+  for (std::thread& worker : this->workers)
+  {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  static ThreadPool pool;
+  return pool;
+}
+
+unsigned int ThreadPool::size() const
+{
+  return static_cast<unsigned int>(this->workers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+  while (true)
+  {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->condition.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+
+      if (this->stopping && this->tasks.empty()) return;
+
+      task = std::move(this->tasks.front());
+      this->tasks.pop();
+    }
+
+    task();
+  }
+}
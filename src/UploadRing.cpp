@@ -0,0 +1,229 @@
+#include "UploadRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "GLExtensions.h"
+
+UploadRing& UploadRing::shared()
+{
+  static UploadRing ring;
+
+  return ring;
+}
+
+UploadRing::UploadRing():
+  mapping(nullptr),
+  frameCapacity(UPLOAD_RING_FRAME_CAPACITY),
+  uniformAlignment(256),
+  frame(0),
+  cursor(0),
+  flushed(0),
+  contextAlive(true)
+{
+}
+
+void UploadRing::create()
+{
+  const GLExtensions& extensions = GLExtensions::get();
+
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if (alignment > 0) this->uniformAlignment = static_cast<size_t>(alignment);
+
+  this->stats.persistent = extensions.persistentMapping;
+  this->stats.frameCapacity = this->frameCapacity;
+  this->fences.assign(UPLOAD_RING_FRAMES, nullptr);
+
+  // Built through GL_COPY_WRITE_BUFFER so no binding the renderer relies on is disturbed.
+  if (this->stats.persistent)
+  {
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size = static_cast<GLsizeiptr>(this->frameCapacity * UPLOAD_RING_FRAMES);
+
+    this->buffers.resize(1);
+    glGenBuffers(1, this->buffers.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffers[0]);
+    extensions.bufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    this->mapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+
+    if (!this->mapping)
+    {
+      std::cerr << "Error: Unable to map the upload ring persistently, falling back to orphaning" << std::endl;
+      glDeleteBuffers(1, this->buffers.data());
+      this->buffers.clear();
+      this->stats.persistent = false;
+    }
+  }
+
+  if (!this->stats.persistent)
+  {
+    this->buffers.resize(UPLOAD_RING_FRAMES);
+    glGenBuffers(UPLOAD_RING_FRAMES, this->buffers.data());
+
+    for (GLuint buffer : this->buffers)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+      glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(this->frameCapacity), nullptr, GL_STREAM_DRAW);
+    }
+
+    this->staging.resize(this->frameCapacity);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void UploadRing::beginFrame()
+{
+  if (!this->contextAlive) return;
+  if (this->buffers.empty()) this->create();
+
+  GLsync& fence = this->fences[this->frame];
+  if (fence)
+  {
+    // Only the persistent path fences; orphaning lets the driver rename the buffer instead.
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stats.fenceWaits++;
+      }
+
+      while (status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  this->cursor.store(0, std::memory_order_relaxed);
+  this->flushed = 0;
+}
+
+UploadAllocation UploadRing::allocate(size_t size, size_t alignment)
+{
+  size_t offset = this->cursor.load(std::memory_order_relaxed);
+  size_t aligned;
+
+  do
+  {
+    aligned = (offset + alignment - 1) / alignment * alignment;
+    if (aligned + size > this->frameCapacity)
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stats.overflows++;
+      return { nullptr, 0, 0 };
+    }
+  }
+  while (!this->cursor.compare_exchange_weak(offset, aligned + size, std::memory_order_relaxed));
+
+  if (this->stats.persistent)
+  {
+    size_t base = static_cast<size_t>(this->frame) * this->frameCapacity;
+    return { this->mapping + base + aligned, static_cast<GLintptr>(base + aligned), size };
+  }
+
+  return { this->staging.data() + aligned, static_cast<GLintptr>(aligned), size };
+}
+
+UploadAllocation UploadRing::upload(const void* data, size_t size, size_t alignment)
+{
+  UploadAllocation allocation = this->allocate(size, alignment);
+  if (allocation.data) std::memcpy(allocation.data, data, size);
+
+  return allocation;
+}
+
+void UploadRing::flush()
+{
+  size_t used = this->cursor.load(std::memory_order_acquire);
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stats.used = used;
+    this->stats.peak = std::max(this->stats.peak, used);
+  }
+
+  // The coherent mapping is already visible; the orphaning path copies the new bytes over.
+  if (this->stats.persistent || !this->contextAlive || used == this->flushed) return;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffers[this->frame]);
+
+  // The first flush orphans, so nothing queued in earlier frames can still read the new storage.
+  if (this->flushed == 0)
+  {
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(this->frameCapacity), nullptr, GL_STREAM_DRAW);
+  }
+
+  // Draws issued since then only read bytes before `flushed`, so the new range can be written without
+  // waiting on them. glBufferSubData would sync against those draws on many drivers.
+  GLsizeiptr size = static_cast<GLsizeiptr>(used - this->flushed);
+  void* destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(this->flushed), size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+  if (destination)
+  {
+    std::memcpy(destination, this->staging.data() + this->flushed, static_cast<size_t>(size));
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  }
+  else
+  {
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(this->flushed), size, this->staging.data() + this->flushed);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  this->flushed = used;
+}
+
+void UploadRing::endFrame()
+{
+  if (!this->contextAlive || this->buffers.empty()) return;
+
+  this->flush();
+
+  if (this->stats.persistent) this->fences[this->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  this->frame = (this->frame + 1) % UPLOAD_RING_FRAMES;
+}
+
+GLuint UploadRing::getBuffer() const
+{
+  if (this->buffers.empty()) return 0;
+
+  return this->stats.persistent ? this->buffers[0] : this->buffers[this->frame];
+}
+
+size_t UploadRing::getUniformAlignment() const
+{
+  return this->uniformAlignment;
+}
+
+UploadRingStats UploadRing::getStats() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  return this->stats;
+}
+
+void UploadRing::shutdown()
+{
+  for (GLsync& fence : this->fences)
+  {
+    if (fence) glDeleteSync(fence);
+    fence = nullptr;
+  }
+
+  if (this->mapping)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, this->buffers[0]);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    this->mapping = nullptr;
+  }
+
+  if (!this->buffers.empty()) glDeleteBuffers(static_cast<GLsizei>(this->buffers.size()), this->buffers.data());
+  this->buffers.clear();
+  this->contextAlive = false;
+}
@@ -0,0 +1,71 @@
+#include "VertexQuantizer.h"
+
+#include <glm/gtc/packing.hpp>
+
+namespace Model
+{
+  PackedVertex packVertex(const Vertex& vertex, const VertexQuantization& quantization)
+  {
+    PackedVertex packed;
+
+    for (int i = 0; i < 3; i++)
+    {
+      float normalized = quantization.scale[i] > 0.0f ? (vertex.position[i] - quantization.offset[i]) / quantization.scale[i] : 0.0f;
+      packed.position[i] = glm::packUnorm1x16(normalized);
+    }
+
+    packed.position[3] = 0;
+    packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+    packed.texCoords[0] = glm::packHalf1x16(vertex.texCoords.x);
+    packed.texCoords[1] = glm::packHalf1x16(vertex.texCoords.y);
+
+    return packed;
+  }
+
+  Vertex unpackVertex(const PackedVertex& packed, const VertexQuantization& quantization)
+  {
+    Vertex vertex;
+
+    for (int i = 0; i < 3; i++)
+    {
+      vertex.position[i] = quantization.offset[i] + quantization.scale[i] * glm::unpackUnorm1x16(packed.position[i]);
+    }
+
+    vertex.normal = glm::vec3(glm::unpackSnorm3x10_1x2(packed.normal));
+    vertex.texCoords = glm::vec2(glm::unpackHalf1x16(packed.texCoords[0]), glm::unpackHalf1x16(packed.texCoords[1]));
+
+    return vertex;
+  }
+
+  void quantizeVertices(MeshData& data)
+  {
+    data.stats.quantized = true;
+    data.stats.vertexBytesBefore = data.vertices.size() * sizeof(Vertex);
+
+    if (!data.vertices.empty())
+    {
+      glm::vec3 minimum = data.vertices[0].position;
+      glm::vec3 maximum = data.vertices[0].position;
+
+      for (const Vertex& vertex : data.vertices)
+      {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+      }
+
+      data.quantization.offset = minimum;
+      data.quantization.scale = maximum - minimum;
+    }
+
+    data.packedVertices.resize(data.vertices.size());
+    for (size_t i = 0; i < data.vertices.size(); i++)
+    {
+      data.packedVertices[i] = packVertex(data.vertices[i], data.quantization);
+    }
+
+    data.vertexFormat = VertexFormat::Packed;
+    std::vector<Vertex>().swap(data.vertices);
+
+    data.stats.vertexBytesAfter = data.packedVertices.size() * sizeof(PackedVertex);
+  }
+}
@@ -0,0 +1,131 @@
+#include "VertexWelder.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+
+#include "Hash.h"
+
+namespace Model
+{
+  constexpr unsigned int WELD_END_OF_CHAIN = ~0u;
+
+  static bool withinTolerance(const Vertex& a, const Vertex& b, const WeldTolerance& tolerance)
+  {
+    for (int i = 0; i < 3; i++)
+    {
+      if (std::fabs(a.position[i] - b.position[i]) > tolerance.position) return false;
+      if (std::fabs(a.normal[i] - b.normal[i]) > tolerance.normal) return false;
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+      if (std::fabs(a.texCoords[i] - b.texCoords[i]) > tolerance.texCoords) return false;
+    }
+
+    return true;
+  }
+
+  static uint64_t cellHash(int64_t x, int64_t y, int64_t z)
+  {
+    int64_t cell[3] = { x, y, z };
+
+    return hashBytes(cell, sizeof(cell));
+  }
+
+  using WeldBuckets = std::unordered_map<uint64_t, unsigned int, std::hash<uint64_t>, std::equal_to<uint64_t>, ArenaAllocator<std::pair<const uint64_t, unsigned int>>>;
+
+  void weldVertices(MeshData& data, const WeldTolerance& tolerance, ImportArena* arena)
+  {
+    ImportArena localArena;
+    ImportArena& scratch = arena ? *arena : localArena;
+
+    size_t vertexCount = data.vertices.size();
+    data.stats.welded = true;
+    data.stats.verticesBefore = static_cast<unsigned int>(vertexCount);
+
+    bool exact = tolerance.position <= 0.0f && tolerance.normal <= 0.0f && tolerance.texCoords <= 0.0f;
+    float cellSize = tolerance.position > 0.0f ? tolerance.position : 1.0f;
+
+    // Buckets hold the head of a chain through `next`; colliding hashes only cost extra comparisons.
+    // Sized up front, since the arena never gets a replaced bucket array back.
+    WeldBuckets buckets(vertexCount, std::hash<uint64_t>(), std::equal_to<uint64_t>(), ArenaAllocator<std::pair<const uint64_t, unsigned int>>(scratch));
+
+    ArenaVector<unsigned int> next((ArenaAllocator<unsigned int>(scratch)));
+    next.reserve(vertexCount);
+
+    ArenaVector<unsigned int> remap(vertexCount, 0, ArenaAllocator<unsigned int>(scratch));
+    std::vector<Vertex> output;
+    output.reserve(vertexCount);
+
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+      const Vertex& vertex = data.vertices[i];
+      unsigned int match = WELD_END_OF_CHAIN;
+      uint64_t key;
+
+      if (exact)
+      {
+        key = hashBytes(&vertex, sizeof(Vertex));
+
+        auto bucket = buckets.find(key);
+        for (unsigned int candidate = bucket != buckets.end() ? bucket->second : WELD_END_OF_CHAIN; candidate != WELD_END_OF_CHAIN; candidate = next[candidate])
+        {
+          if (std::memcmp(&output[candidate], &vertex, sizeof(Vertex)) == 0)
+          {
+            match = candidate;
+            break;
+          }
+        }
+      }
+      else
+      {
+        int64_t cell[3];
+        for (int axis = 0; axis < 3; axis++) cell[axis] = static_cast<int64_t>(std::floor(vertex.position[axis] / cellSize));
+
+        key = cellHash(cell[0], cell[1], cell[2]);
+
+        // A match within one cell size on every axis can only live in the 27 surrounding cells.
+        for (int dz = -1; dz <= 1 && match == WELD_END_OF_CHAIN; dz++)
+        {
+          for (int dy = -1; dy <= 1 && match == WELD_END_OF_CHAIN; dy++)
+          {
+            for (int dx = -1; dx <= 1 && match == WELD_END_OF_CHAIN; dx++)
+            {
+              auto bucket = buckets.find(cellHash(cell[0] + dx, cell[1] + dy, cell[2] + dz));
+              if (bucket == buckets.end()) continue;
+
+              for (unsigned int candidate = bucket->second; candidate != WELD_END_OF_CHAIN; candidate = next[candidate])
+              {
+                if (withinTolerance(output[candidate], vertex, tolerance))
+                {
+                  match = candidate;
+                  break;
+                }
+              }
+            }
+          }
+        }
+      }
+
+      if (match == WELD_END_OF_CHAIN)
+      {
+        match = static_cast<unsigned int>(output.size());
+        output.push_back(vertex);
+
+        auto inserted = buckets.emplace(key, match);
+        next.push_back(inserted.second ? WELD_END_OF_CHAIN : inserted.first->second);
+        inserted.first->second = match;
+      }
+
+      remap[i] = match;
+    }
+
+    for (unsigned int& index : data.indices) index = remap[index];
+
+    data.vertices.swap(output);
+    data.stats.verticesAfter = static_cast<unsigned int>(data.vertices.size());
+  }
+}
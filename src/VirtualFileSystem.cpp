@@ -0,0 +1,149 @@
+#include "VirtualFileSystem.h"
+
+#include <filesystem>
+#include <iostream>
+
+VirtualFileSystem& VirtualFileSystem::shared()
+{
+  static VirtualFileSystem fileSystem;
+
+  return fileSystem;
+}
+
+VirtualFileSystem::VirtualFileSystem():
+  mounted(false)
+{
+}
+
+bool VirtualFileSystem::mount(const std::string& packPath, const std::string& root)
+{
+  if (!this->pack.open(packPath)) return false;
+
+  // Resolved once so lookups stay purely lexical and never touch the file system.
+  std::error_code error;
+  this->workingDirectory = std::filesystem::current_path(error).generic_string();
+  this->root = std::filesystem::absolute(root, error).lexically_normal().generic_string();
+  if (!this->root.empty() && this->root.back() == '/') this->root.pop_back();
+
+  this->mounted = true;
+
+  std::cout << "Mounted " << packPath << " (" << this->pack.getEntryCount() << " files)" << std::endl;
+
+  return true;
+}
+
+bool VirtualFileSystem::isMounted() const
+{
+  return this->mounted;
+}
+
+std::string VirtualFileSystem::packPath(const std::string& path) const
+{
+  std::filesystem::path full(path);
+  if (full.is_relative()) full = std::filesystem::path(this->workingDirectory) / full;
+
+  std::string normalized = full.lexically_normal().generic_string();
+  if (normalized.compare(0, this->root.size(), this->root) != 0 || normalized.size() <= this->root.size() || normalized[this->root.size()] != '/') return std::string();
+
+  return normalized.substr(this->root.size() + 1);
+}
+
+bool VirtualFileSystem::find(const std::string& path, const unsigned char*& data, size_t& size) const
+{
+  if (!this->mounted) return false;
+
+  std::string relative = this->packPath(path);
+
+  return !relative.empty() && this->pack.find(relative, data, size);
+}
+
+bool VirtualFileSystem::prefetch(const std::string& path) const
+{
+  AssetFile file;
+  if (!file.open(path)) return false;
+
+  constexpr size_t PAGE_SIZE = 4096;
+  volatile unsigned char sink = 0;
+  for (size_t offset = 0; offset < file.size(); offset += PAGE_SIZE)
+  {
+    sink = sink + file.data()[offset];
+  }
+
+  return true;
+}
+
+AssetFile::AssetFile():
+  view(nullptr),
+  length(0)
+{
+}
+
+AssetFile::AssetFile(AssetFile&& other) noexcept:
+  loose(std::move(other.loose)),
+  view(other.view),
+  length(other.length)
+{
+  other.view = nullptr;
+  other.length = 0;
+}
+
+AssetFile& AssetFile::operator=(AssetFile&& other) noexcept
+{
+  if (this != &other)
+  {
+    this->loose = std::move(other.loose);
+    this->view = other.view;
+    this->length = other.length;
+    other.view = nullptr;
+    other.length = 0;
+  }
+
+  return *this;
+}
+
+bool AssetFile::open(const std::string& path, AssetLookup lookup)
+{
+  this->close();
+
+  if (lookup == AssetLookup::LooseFirst && this->loose.open(path))
+  {
+    this->view = this->loose.data();
+    this->length = this->loose.size();
+
+    return true;
+  }
+
+  if (VirtualFileSystem::shared().find(path, this->view, this->length) && this->length > 0) return true;
+
+  // An empty pack entry never hides the loose file.
+  this->view = nullptr;
+  this->length = 0;
+  if (lookup == AssetLookup::LooseFirst || !this->loose.open(path)) return false;
+
+  this->view = this->loose.data();
+  this->length = this->loose.size();
+
+  return true;
+}
+
+void AssetFile::close()
+{
+  this->loose.close();
+  this->view = nullptr;
+  this->length = 0;
+}
+
+bool AssetFile::isOpen() const
+{
+  return this->view != nullptr;
+}
+
+const unsigned char* AssetFile::data() const
+{
+  return this->view;
+}
+
+size_t AssetFile::size() const
+{
+  return this->length;
+}
@@ -11,6 +11,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <memory>
 #include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -20,11 +21,23 @@
 #include "Texture.h"
 #include "Camera.h"
 #include "Model.h"
+#include "RenderQueue.h"
+#include "FrameConstants.h"
+#include "GLExtensions.h"
+#include "TextureCooker.h"
+#include "TextureLoader.h"
+#include "TextureRegistry.h"
+#include "UploadRing.h"
+#include "VirtualFileSystem.h"
+#include "InitGraph.h"
+#include "StartupProfiler.h"
 
 const int WINDOW_WIDTH = 800;
 const int WINDOW_HEIGHT = 600;
 const std::string WINDOW_TITLE = "MAT392 - Mathematics in Computer Graphics Demo";
 const float WINDOW_ASPECT_RATIO = WINDOW_WIDTH / WINDOW_HEIGHT;
+const unsigned int FOREST_SIZE = 100;
+const float FOREST_SPACING = 2.0f;
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = WINDOW_WIDTH * 0.5f;
@@ -81,6 +94,8 @@ unsigned int frameCount = 0;
 
 bool mouseLocked = false;
 bool wireFrame = false;
+// Off by default because some models rely on their back faces; meshlet cone culling follows it.
+bool backfaceCulling = false;
 bool useSkybox = true;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -100,120 +115,232 @@ void processInput(GLFWwindow* window)
 
 int main(int argc, char** argv)
 {
-  if (!glfwInit())
+  StartupProfiler& profiler = StartupProfiler::shared();
+  InitGraph startup;
+
+  GLFWwindow* window = NULL;
+  std::unique_ptr<Shader> airplaneShader;
+  std::unique_ptr<Shader> skyboxShader;
+  std::unique_ptr<Model::Model> airplaneModel;
+  std::unique_ptr<Shader> forestShader;
+  std::unique_ptr<Model::Model> treeModel;
+
+  const std::string airplanePath = "./../res/models/airplane/11805_airplane_v2_L2.obj";
+  //const std::string airplanePath = "./../res//models/tree-high/tree01.obj";
+  Model::ModelOptions airplaneOptions;
+  airplaneOptions.importer = Model::ModelImporter::NativeObj;
+  airplaneOptions.weldVertices = true;
+  airplaneOptions.optimizeMeshes = true;
+  airplaneOptions.buildMeshlets = true;
+  airplaneOptions.lodLevels = 4;
+  airplaneOptions.vertexFormat = Model::VertexFormat::Packed;
+  airplaneOptions.residency = Model::GeometryResidency::Discard;
+
+  const std::string treePath = "./../res/models/tree-low/Lowpoly_tree_sample.obj";
+  Model::ModelOptions treeOptions;
+  treeOptions.importer = Model::ModelImporter::NativeObj;
+  treeOptions.optimizeMeshes = true;
+  treeOptions.vertexFormat = Model::VertexFormat::Packed;
+  treeOptions.residency = Model::GeometryResidency::Discard;
+
+  // R L T B B F
+  std::vector<std::string> faces =
   {
-    std::cerr << "Failed to initiaize GLFW" << std::endl;
-    return EXIT_FAILURE;
-  }
+    "./../res/images/skyrender0005.bmp",
+    "./../res/images/skyrender0001.bmp",
+    "./../res/images/skyrender0003.bmp", // DON'T TOUCH!
+    "./../res/images/skyrender0006.bmp", // DON'T TOUCH!
+    "./../res/images/skyrender0004.bmp",
+    "./../res/images/skyrender0002.bmp",
+  };
+  const std::string cookedSkyboxPath = "./../res/images/skybox.ctex";
+  PendingCubemap skyboxDecode;
+  uint64_t skyboxSourceSize = 0, skyboxSourceHash = 0;
+  unsigned int skybox = 0;
+  unsigned int skyboxVAO, skyboxVBO;
+
+  // Built by the pack tool from the repo root; loose files are used for anything it does not contain.
+  unsigned int mountAssets = startup.add("Mount assets", InitThread::Main, []()
+  {
+    VirtualFileSystem::shared().mount("./../assets.pack", "./..");
+    return true;
+  });
+
+  // CPU-only steps are queued first so the pool works on them while the window and context are created.
+  unsigned int decodeSkybox = startup.add("Start skybox decode", InitThread::Main, [&]()
+  {
+    // A cube map packed by the texture cooker (--cubemap) skips decoding the six faces. One cooked
+    // from older faces is rebuilt with its original options, and the faces are decoded if that fails.
+    bool cookedIsFresh = false;
+    {
+      TextureContainer cooked;
+      if (TextureContainer::fingerprintCubemap(faces, skyboxSourceSize, skyboxSourceHash) && cooked.open(cookedSkyboxPath, AssetLookup::LooseFirst))
+      {
+        cookedIsFresh = cooked.matchesSource(skyboxSourceSize, skyboxSourceHash);
+        if (!cookedIsFresh)
+        {
+          TextureCookOptions options = cookOptionsFor(cooked.getHeader());
+          cooked = TextureContainer();
+          std::cout << "Recooking " << cookedSkyboxPath << ", its faces changed" << std::endl;
+          cookedIsFresh = cookCubemap(faces, cookedSkyboxPath, options);
+        }
+      }
+    }
+
+    if (!cookedIsFresh) skyboxDecode = TextureLoader::decodeCubemap(faces);
+    return true;
+  }, { mountAssets });
+
+  unsigned int prefetchAirplane = startup.add("Prefetch airplane", InitThread::Worker, [&]()
+  {
+    VirtualFileSystem::shared().prefetch(airplanePath);
+    return true;
+  }, { mountAssets });
+
+  unsigned int buildFonts = startup.add("Build ImGui font atlas", InitThread::Worker, []()
+  {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
 
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    unsigned char* pixels;
+    int width, height;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    return true;
+  });
+
+  unsigned int createWindow = startup.add("Create window", InitThread::Main, [&]()
+  {
+    if (!glfwInit())
+    {
+      std::cerr << "Failed to initiaize GLFW" << std::endl;
+      return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-  GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE.c_str(), NULL, NULL);
-  if (window == NULL)
+    window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE.c_str(), NULL, NULL);
+    if (window == NULL)
+    {
+      std::cerr << "Failed to create GLFW window" << std::endl;
+      return false;
+    }
+
+    glfwMakeContextCurrent(window);
+    return true;
+  }, { mountAssets });
+
+  unsigned int loadGL = startup.add("Load OpenGL", InitThread::Main, [&]()
   {
-    std::cerr << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+    {
+      std::cerr << "Failed to initiaize GLAD" << std::endl;
+      return false;
+    }
 
-    return EXIT_FAILURE;
-  }
+    GLExtensions::load();
+
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_WIDTH);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetKeyCallback(window, key_callback);
+    glfwSetInputMode(window, GLFW_CURSOR, mouseLocked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_HIDDEN);
 
-  glfwMakeContextCurrent(window);
+    glEnable(GL_DEPTH_TEST);
+    return true;
+  }, { createWindow });
 
-  if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+  startup.add("Compile shaders", InitThread::Main, [&]()
   {
-    std::cerr << "Failed to initiaize GLAD" << std::endl;
-    return EXIT_FAILURE;
-  }
+    airplaneShader = std::make_unique<Shader>("./../shaders/airplane/vertex.glsl", "./../shaders/airplane/fragment.glsl");
+    skyboxShader = std::make_unique<Shader>("./../shaders/skybox/vertex.glsl", "./../shaders/skybox/fragment.glsl");
 
-  glViewport(0, 0, WINDOW_WIDTH, WINDOW_WIDTH);
-  glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-  glfwSetCursorPosCallback(window, mouse_callback);
-  glfwSetKeyCallback(window, key_callback);
-  glfwSetInputMode(window, GLFW_CURSOR, mouseLocked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_HIDDEN);
+    forestShader = std::make_unique<Shader>("./../shaders/instanced/vertex.glsl", "./../shaders/instanced/fragment.glsl");
 
-  glEnable(GL_DEPTH_TEST);
+    skyboxShader->use();
+    skyboxShader->setInt("skybox", 0);
+    forestShader->use();
+    forestShader->setVec3("baseColour", glm::vec3(0.26f, 0.44f, 0.11f));
+    return true;
+  }, { loadGL });
 
   // Model from https://free3d.com/3d-model/airplane-v2--549103.html
-  Shader airplaneShader("./../shaders/airplane/vertex.glsl", "./../shaders/airplane/fragment.glsl");
-  Model::Model airplaneModel("./../res/models/airplane/11805_airplane_v2_L2.obj");
-  //Model::Model airplaneModel("./../res//models/tree-high/tree01.obj");
-
-  glm::vec3 airplanePosition(0.0f, 0.0f, 0.0f);
-  glm::vec3 airplaneRotation(0.0f, 0.0f, 0.0f);
-  glm::vec3 airplaneScale(0.001f, 0.001f, 0.001f);
-  //glm::vec3 airplaneScale(.1f, .1f, .1f);
-
-  float ambientLight = 0.5;
-  glm::vec3 ambientColour(1.0f, 1.0f, 1.0f);
+  startup.add("Import airplane", InitThread::Main, [&]()
+  {
+    airplaneModel = std::make_unique<Model::Model>(airplanePath, airplaneOptions);
+    return true;
+  }, { loadGL, prefetchAirplane });
 
-  // Skybox
-  Shader skyboxShader("./../shaders/skybox/vertex.glsl", "./../shaders/skybox/fragment.glsl");
-  unsigned int skyboxVAO, skyboxVBO;
-  glGenVertexArrays(1, &skyboxVAO);
-  glGenBuffers(1, &skyboxVBO);
-  glBindVertexArray(skyboxVAO);
-  glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void*>(0));
-
-  unsigned int skybox;
-  glGenTextures(1, &skybox);
-  glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
+  startup.add("Import trees", InitThread::Main, [&]()
+  {
+    treeModel = std::make_unique<Model::Model>(treePath, treeOptions);
+    return true;
+  }, { loadGL });
 
-  // R L T B B F
-  std::vector<std::string> faces =
+  startup.add("Upload skybox", InitThread::Main, [&]()
   {
-    "./../res/images/skyrender0005.bmp",
-    "./../res/images/skyrender0001.bmp",
-    "./../res/images/skyrender0003.bmp", // DON'T TOUCH!
-    "./../res/images/skyrender0006.bmp", // DON'T TOUCH!
-    "./../res/images/skyrender0004.bmp",
-    "./../res/images/skyrender0002.bmp",
-  };
-  int width, height, nrChannels;
-  unsigned char* data;
-  for (unsigned int i = 0; i < faces.size(); i++)
+    glGenVertexArrays(1, &skyboxVAO);
+    glGenBuffers(1, &skyboxVBO);
+    glBindVertexArray(skyboxVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), reinterpret_cast<void*>(0));
+
+    skybox = skyboxDecode.decodes.empty() ? TextureLoader::shared().loadCookedCubemap(cookedSkyboxPath, skyboxSourceSize, skyboxSourceHash) : TextureLoader::shared().uploadCubemap(skyboxDecode);
+    if (!skybox) skybox = TextureLoader::shared().loadCubemap(faces);
+    return true;
+  }, { loadGL, decodeSkybox });
+
+  startup.add("Initialize ImGui backends", InitThread::Main, [&]()
   {
-    data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-    if (data)
-    {
-      glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    }
-    else
-    {
-      std::cerr << "Failed to load skybox" << std::endl;
-    }
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330 core");
+    return true;
+  }, { loadGL, buildFonts });
 
-    stbi_image_free(data);
+  if (!startup.run())
+  {
+    if (window) glfwTerminate();
+    return EXIT_FAILURE;
   }
 
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-  skyboxShader.use();
-  skyboxShader.setInt("skybox", 0);
+  glm::vec3 airplanePosition(0.0f, 0.0f, 0.0f);
+  glm::vec3 airplaneRotation(0.0f, 0.0f, 0.0f);
+  glm::vec3 airplaneScale(0.001f, 0.001f, 0.001f);
+  //glm::vec3 airplaneScale(.1f, .1f, .1f);
 
-  std::cout << "Initializing imgui!" << std::endl;
-  IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
-  //ImGuiIO& io = ImGui::GetIO();
-  ImGui::StyleColorsDark();
-  ImGui_ImplGlfw_InitForOpenGL(window, true);
-  ImGui_ImplOpenGL3_Init("#version 330 core");
+  float ambientLight = 0.5;
+  glm::vec3 ambientColour(1.0f, 1.0f, 1.0f);
 
   std::cout << "Starting Program!" << std::endl;
   int numFrames = 0;
   double timer = 0.0;
+  bool airplaneLoaded = false;
+  RenderQueue renderQueue;
+
+  // A FOREST_SIZE x FOREST_SIZE grid of trees below the airplane, jittered so the rows don't line up.
+  bool showForest = true;
+  std::vector<glm::mat4> forest;
+  forest.reserve(FOREST_SIZE * FOREST_SIZE);
+  for (unsigned int i = 0; i < FOREST_SIZE * FOREST_SIZE; i++)
+  {
+    float jitter = static_cast<float>((i * 2654435761u) % 1000) / 1000.0f;
+    glm::vec3 position((i % FOREST_SIZE) * FOREST_SPACING, -5.0f, (i / FOREST_SIZE) * FOREST_SPACING);
+    position.x += (jitter - 0.5f) * FOREST_SPACING - FOREST_SIZE * FOREST_SPACING * 0.5f;
+    position.z += (0.5f - jitter) * FOREST_SPACING - FOREST_SIZE * FOREST_SPACING * 0.5f;
+
+    glm::mat4 tree = glm::translate(glm::mat4(1.0f), position);
+    tree = glm::rotate(tree, jitter * glm::two_pi<float>(), glm::vec3(0.0f, 1.0f, 0.0f));
+    tree = glm::scale(tree, glm::vec3(0.04f + 0.03f * jitter));
+    forest.push_back(tree);
+  }
   // Main Loop
   while (!glfwWindowShouldClose(window))
   {
@@ -229,6 +356,7 @@ int main(int argc, char** argv)
     }
     lastFrame = currentFrame;
 
+    UploadRing::shared().beginFrame();
     processInput(window);
 
     glfwSetInputMode(window, GLFW_CURSOR, mouseLocked ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_HIDDEN);
@@ -250,38 +378,51 @@ int main(int argc, char** argv)
     glm::mat4 projection = glm::mat4(1.0f);
     projection = glm::perspective(glm::radians(camera.fov), WINDOW_ASPECT_RATIO, camera.nearPlane, camera.farPlane);
 
-    /* Send model, view, and projection matrix to the vertex shader */
-    airplaneShader.use();
-    airplaneShader.setMat4("projection", projection);
-    airplaneShader.setMat4("view", view);
+    /* Camera and lighting go to every program through one uniform buffer */
+    FrameConstants frameConstants;
+    frameConstants.view = view;
+    frameConstants.projection = projection;
+    frameConstants.viewProjection = projection * view;
+    frameConstants.cameraPosition = camera.position;
+    frameConstants.time = currentFrame;
+    frameConstants.ambientColour = ambientColour;
+    frameConstants.ambientStrength = ambientLight;
+    bindFrameConstants(frameConstants);
 
     model = glm::translate(model, airplanePosition);
     model = glm::scale(model, airplaneScale);
     model = glm::rotate(model, glm::radians(airplaneRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
     model = glm::rotate(model, glm::radians(airplaneRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
     model = glm::rotate(model, glm::radians(airplaneRotation.z), glm::vec3(1.0f, 0.0f, 1.0f));
-    airplaneShader.setMat4("model", model);
-    airplaneModel.draw(airplaneShader);
+    TextureLoader::shared().update();
+    airplaneModel->uploadPending();
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-    airplaneShader.setFloat("ambientStrength", ambientLight);
-    airplaneShader.setVec3("ambientColour", ambientColour);
+    if (backfaceCulling) glEnable(GL_CULL_FACE);
+
+    renderQueue.begin(view);
+    Model::MeshletCullContext airplaneCull(projection, view, model, backfaceCulling);
+    Model::LodSelector airplaneLod(camera, static_cast<float>(framebufferHeight), model);
+    airplaneModel->enqueue(renderQueue, *airplaneShader, renderQueue.addTransform(model), airplaneCull, airplaneLod);
+    renderQueue.submit();
+
+    glDisable(GL_CULL_FACE);
+
+    treeModel->uploadPending();
+    if (showForest) treeModel->drawInstanced(*forestShader, forest);
 
     if (useSkybox)
     {
       glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
       glDepthFunc(GL_LEQUAL);
-      skyboxShader.use();
-      view = glm::mat4(glm::mat3(view));
-      skyboxShader.setMat4("view", view);
-      skyboxShader.setMat4("projection", projection);
+      skyboxShader->use();
       glBindVertexArray(skyboxVAO);
       glActiveTexture(GL_TEXTURE0);
       glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
       glDrawArrays(GL_TRIANGLES, 0, 36);
       glBindVertexArray(0);
       glDepthFunc(GL_LESS);
-
-      skyboxShader.setFloat("ambientStrength", ambientLight);
     }
 
     ImGui_ImplOpenGL3_NewFrame();
@@ -292,10 +433,48 @@ int main(int argc, char** argv)
     ImGui::Begin("Menu :)");
     ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%dms/frame", frameCount);
 
+    TextureMemory textureMemory = TextureLoader::shared().getMemory();
+    ImGui::Text("Texture VRAM: %.2f MB (%.2f MB as RGBA8)", textureMemory.residentBytes / (1024.0 * 1024.0), textureMemory.uncompressedBytes / (1024.0 * 1024.0));
+
+    const Model::MeshletCullStats& cullStats = airplaneModel->getCullStats();
+    ImGui::Text("Meshlets: %u / %u visible in %u draws", cullStats.visible, cullStats.total, cullStats.drawRanges);
+
+    const Model::LodStats& lodStats = airplaneModel->getLodStats();
+    ImGui::Text("LOD triangles: %u / %u", lodStats.trianglesDrawn, lodStats.fullDetailTriangles);
+
+    const RenderQueueStats& queueStats = renderQueue.getStats();
+    ImGui::Text("Render queue: %u items, %u draws, %u program / %u material / %u VAO changes",
+      queueStats.items, queueStats.drawCalls, queueStats.programChanges, queueStats.materialChanges, queueStats.vertexArrayChanges);
+    ImGui::Text("  %u indirect batches covering %u draws (%s), %u overflow draws", queueStats.batches, queueStats.batchedDraws,
+      GLExtensions::get().multiDrawIndirect ? "multi-draw indirect" : "looped", queueStats.overflowDraws);
+
+    Model::GeometryMemory airplaneMemory = airplaneModel->getMemory();
+    ImGui::Text("Airplane geometry: %.2f MB CPU, %.2f MB GPU", airplaneMemory.cpuBytes / (1024.0 * 1024.0), airplaneMemory.gpuBytes / (1024.0 * 1024.0));
+
+    for (Model::VertexFormat format : { Model::VertexFormat::Float, Model::VertexFormat::Packed })
+    {
+      Model::GeometryPoolStats heapStats = Model::GeometryHeap::shared().getStats(format);
+      if (heapStats.allocations == 0) continue;
+
+      ImGui::Text("Geometry %s: %.2f / %.2f MB vertices, %.2f / %.2f MB indices",
+        format == Model::VertexFormat::Packed ? "packed" : "float",
+        heapStats.vertexUsed / (1024.0 * 1024.0), heapStats.vertexCapacity / (1024.0 * 1024.0),
+        heapStats.indexUsed / (1024.0 * 1024.0), heapStats.indexCapacity / (1024.0 * 1024.0));
+      ImGui::Text("  %u meshes, %u free blocks, %.0f%% fragmented, %u compactions",
+        heapStats.allocations, heapStats.freeBlocks, heapStats.fragmentation * 100.0f, heapStats.defragmentations);
+    }
+
+    UploadRingStats ringStats = UploadRing::shared().getStats();
+    ImGui::Text("Upload ring (%s): %.1f / %.1f KB, peak %.1f KB, %u fence waits",
+      ringStats.persistent ? "persistent" : "orphaning", ringStats.used / 1024.0, ringStats.frameCapacity / 1024.0,
+      ringStats.peak / 1024.0, ringStats.fenceWaits);
+
     // Keybinds
     ImGui::Checkbox("Mouse Lock (M)", &mouseLocked);
     ImGui::Checkbox("Wireframe (N)", &wireFrame);
+    ImGui::Checkbox("Back-face culling", &backfaceCulling);
     ImGui::Checkbox("Skybox (B)", &useSkybox);
+    ImGui::Checkbox("Forest", &showForest);
 
     // Airplane transform
     ImGui::SliderFloat3("Scale", reinterpret_cast<float*>(&airplaneScale), 0.001f, 0.01f);
@@ -311,8 +490,20 @@ int main(int argc, char** argv)
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+    UploadRing::shared().endFrame();
     glfwSwapBuffers(window);
     glfwPollEvents();
+
+    profiler.markFirstFrame();
+
+    // Meshes keep streaming in after the first frame, so full load is tracked separately.
+    if (!airplaneLoaded && airplaneModel->isLoaded())
+    {
+      airplaneLoaded = true;
+      profiler.mark("Airplane fully loaded");
+      std::cout << "Airplane fully loaded after " << profiler.now() << " ms" << std::endl;
+      profiler.exportTrace(STARTUP_TRACE_PATH);
+    }
   }
 
   ImGui_ImplOpenGL3_Shutdown();
@@ -322,6 +513,10 @@ int main(int argc, char** argv)
   glDeleteVertexArrays(1, &skyboxVAO);
   glDeleteBuffers(1, &skyboxVBO);
 
+  TextureRegistry::shared().shutdown();
+  renderQueue.shutdown();
+  Model::GeometryHeap::shared().shutdown();
+  UploadRing::shared().shutdown();
   glfwTerminate();
 
   return EXIT_SUCCESS;
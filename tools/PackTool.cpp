@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PackFile.h"
+
+// Offline packer: bundles the given files and directories (relative to <root>) into one archive
+// the runtime mounts at startup. Cooked .ctex and .meshcache files are packed like any other
+// asset, so re-run the cooker and the app before packing to ship up-to-date caches. A loose
+// .meshcache the app writes later still takes precedence over the packed one.
+int main(int argc, char** argv)
+{
+  if (argc < 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " <output.pack> <root> <file or directory>..." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string outputPath = argv[1];
+  std::filesystem::path root = argv[2];
+  std::vector<std::string> paths;
+
+  for (int i = 3; i < argc; i++)
+  {
+    std::filesystem::path input = root / argv[i];
+    std::error_code error;
+
+    if (std::filesystem::is_regular_file(input, error))
+    {
+      paths.push_back(input.lexically_relative(root).generic_string());
+      continue;
+    }
+
+    if (!std::filesystem::is_directory(input, error))
+    {
+      std::cerr << "Warning: Skipping missing input " << input.string() << std::endl;
+      continue;
+    }
+
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(input, error))
+    {
+      if (!entry.is_regular_file()) continue;
+
+      paths.push_back(entry.path().lexically_relative(root).lexically_normal().generic_string());
+    }
+  }
+
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+  if (!PackFile::write(outputPath, root.string(), paths)) return EXIT_FAILURE;
+
+  std::cout << "Packed " << paths.size() << " files -> " << outputPath << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "TextureCooker.h"
+
+static void printUsage(const char* program)
+{
+  std::cerr << "Usage: " << program << " [--srgb] [--no-mips] [--bc1|--bc3|--bc7] <image>..." << std::endl;
+  std::cerr << "       " << program << " [options] --cubemap <output.ctex> <+x> <-x> <+y> <-y> <+z> <-z>" << std::endl;
+}
+
+// Offline texture cooker: writes <image>.ctex next to every input image. The runtime picks the
+// cooked file up automatically while its recorded source hash still matches the image. --cubemap
+// cooks six faces into one cube map container at the given output path.
+int main(int argc, char** argv)
+{
+  TextureCookOptions options;
+  options.srgb = false;
+  options.generateMipmaps = true;
+  options.compress = false;
+  options.blockFormat = BlockFormat::BC1;
+
+  int cooked = 0, failed = 0;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--srgb") == 0)
+    {
+      options.srgb = true;
+      continue;
+    }
+
+    if (std::strcmp(argv[i], "--no-mips") == 0)
+    {
+      options.generateMipmaps = false;
+      continue;
+    }
+
+    if (std::strcmp(argv[i], "--bc1") == 0 || std::strcmp(argv[i], "--bc3") == 0 || std::strcmp(argv[i], "--bc7") == 0)
+    {
+      options.compress = true;
+      options.blockFormat = argv[i][4] == '1' ? BlockFormat::BC1 : argv[i][4] == '3' ? BlockFormat::BC3 : BlockFormat::BC7;
+      continue;
+    }
+
+    if (std::strcmp(argv[i], "--cubemap") == 0)
+    {
+      if (i + 1 + CUBEMAP_FACE_COUNT >= static_cast<unsigned int>(argc))
+      {
+        std::cerr << "Error: --cubemap expects an output path followed by " << CUBEMAP_FACE_COUNT << " faces" << std::endl;
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+      }
+
+      std::string outputPath = argv[i + 1];
+      std::vector<std::string> faces(argv + i + 2, argv + i + 2 + CUBEMAP_FACE_COUNT);
+      i += 1 + CUBEMAP_FACE_COUNT;
+
+      if (cookCubemap(faces, outputPath, options))
+      {
+        std::cout << "Cooked cube map -> " << outputPath << std::endl;
+        cooked++;
+      }
+      else
+      {
+        failed++;
+      }
+
+      continue;
+    }
+
+    std::string sourcePath = argv[i];
+    std::string outputPath = TextureContainer::cookedPath(sourcePath);
+
+    if (cookTexture(sourcePath, outputPath, options))
+    {
+      std::cout << "Cooked " << sourcePath << " -> " << outputPath << std::endl;
+      cooked++;
+    }
+    else
+    {
+      failed++;
+    }
+  }
+
+  if (cooked + failed == 0)
+  {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}